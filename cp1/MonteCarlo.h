@@ -0,0 +1,60 @@
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include <vector>
+#include <stdint.h>
+#include <omp.h>
+#include "Random.h"
+
+/*
+   Runs independent Monte Carlo experiments over all cores. Run i always draws from stream i of the seed, whichever 
+   thread picks it up, so a seed reproduces its results exactly for any number of threads (and a different seed 
+   gives an independent set)
+*/
+class MonteCarlo {
+public:
+   MonteCarlo(const uint64_t seed, const size_t N_threads = 0) : m_seed(seed), m_N_threads(N_threads) { }
+
+   uint64_t seed() const { return m_seed; }
+   size_t threads() const { return (m_N_threads > 0) ? m_N_threads : omp_get_max_threads(); }
+
+   // result[i] = experiment(i, rng) for each run i, where rng is that run's own generator
+   template<class Experiment>
+   std::vector<double> run(const size_t N_runs, Experiment experiment) const {
+      std::vector<double> results(N_runs);
+      #pragma omp parallel for schedule(dynamic) num_threads(threads())
+      for (size_t i = 0; i < N_runs; i++) {
+         Xoshiro256 rng(m_seed, i);
+         results[i] = experiment(i, rng);
+      }
+      return results;
+   }
+
+   /* experiment(i, rng, &accumulator) for each run, adding whatever it measures into an accumulator with a merge() 
+      (see Statistics.h) instead of returning it, so nothing grows with N_runs. Each block of MC_BLOCK consecutive 
+      runs adds into its own copy of prototype and the blocks are merged in order at the end, so even the rounding 
+      doesn't depend on the number of threads */
+   template<class Accumulator, class Experiment>
+   Accumulator accumulate(const size_t N_runs, const Accumulator& prototype, Experiment experiment) const {
+      const size_t N_blocks = (N_runs + MC_BLOCK - 1) / MC_BLOCK;
+      std::vector<Accumulator> blocks(N_blocks, prototype);
+      #pragma omp parallel for schedule(dynamic) num_threads(threads())
+      for (size_t b = 0; b < N_blocks; b++) {
+         for (size_t i = b*MC_BLOCK; i < N_runs && i < (b+1)*MC_BLOCK; i++) {
+            Xoshiro256 rng(m_seed, i);
+            experiment(i, rng, &blocks[b]);
+         }
+      }
+      Accumulator total = prototype;
+      for (size_t b = 0; b < N_blocks; b++) total.merge(blocks[b]);
+      return total;
+   }
+
+   static const size_t MC_BLOCK = 64;
+
+private:
+   uint64_t m_seed;
+   size_t m_N_threads; // 0 for all of them
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include <math.h>
+#include <algorithm>
+#include "../global.h"
+#include "QuasiRandom.h"
+
+namespace {
+/* Joe & Kuo's new-joe-kuo-6.21201 direction numbers for dimensions 2 to SOBOL_MAX_DIMS: degree s of the primitive 
+   polynomial, its inner coefficients a as bits, and the first s direction numbers m. Dimension 1 is all m = 1 */
+struct SobolPolynomial {
+   unsigned s;
+   unsigned a;
+   unsigned m[7];
+};
+const SobolPolynomial SOBOL_POLYNOMIALS[SOBOL_MAX_DIMS-1] = {
+   { 1,  0, { 1 } },
+   { 2,  1, { 1, 3 } },
+   { 3,  1, { 1, 3, 1 } },
+   { 3,  2, { 1, 1, 1 } },
+   { 4,  1, { 1, 1, 3, 3 } },
+   { 4,  4, { 1, 3, 5, 13 } },
+   { 5,  2, { 1, 1, 5, 5, 17 } },
+   { 5,  4, { 1, 1, 5, 5, 5 } },
+   { 5,  7, { 1, 1, 7, 11, 19 } },
+   { 5, 11, { 1, 1, 5, 1, 1 } },
+   { 5, 13, { 1, 1, 1, 3, 11 } },
+   { 5, 14, { 1, 3, 5, 5, 31 } },
+   { 6,  1, { 1, 3, 3, 9, 7, 49 } },
+   { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+   { 6, 16, { 1, 3, 1, 13, 27, 49 } },
+   { 6, 19, { 1, 1, 1, 15, 7, 5 } },
+   { 6, 22, { 1, 3, 1, 15, 13, 25 } },
+   { 6, 25, { 1, 1, 5, 5, 19, 61 } },
+   { 7,  1, { 1, 3, 7, 11, 23, 15, 103 } },
+   { 7,  4, { 1, 3, 7, 13, 13, 15, 69 } }
+};
+
+const uint32_t PRIMES[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 
+                            83, 89, 97, 101, 103, 107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173 };
+const size_t HALTON_MAX_DIMS = sizeof(PRIMES) / sizeof(PRIMES[0]);
+
+// top 53 bits as a double in [0,1)
+inline double to_unit(const uint64_t x) { return (x >> 11) * (1.0 / 9007199254740992.0); }
+}
+
+Sobol::Sobol(const size_t N_dims) : m_N_dims(N_dims), m_shift(N_dims, 0) {
+   initialise();
+}
+
+Sobol::Sobol(const size_t N_dims, Xoshiro256& rng) : m_N_dims(N_dims), m_shift(N_dims) {
+   for (size_t j = 0; j < N_dims; j++) m_shift[j] = rng.next();
+   initialise();
+}
+
+/*
+   Direction number k of a dimension is m_k/2^k, stored here as a 64 bit fraction V[k] = m_k << (63-k). The first s 
+   come from the table and the rest from the polynomial's recurrence, 
+      V[k] = V[k-s] ^ (V[k-s] >> s) ^ a_1*V[k-1] ^ ... ^ a_(s-1)*V[k-s+1]
+*/
+void Sobol::initialise() {
+   ASSERT( m_N_dims >= 1 && m_N_dims <= SOBOL_MAX_DIMS );
+   m_directions.assign(64*m_N_dims, 0);
+   for (size_t k = 0; k < 64; k++) m_directions[k] = 1ull << (63-k);
+
+   for (size_t j = 1; j < m_N_dims; j++) {
+      const SobolPolynomial& poly = SOBOL_POLYNOMIALS[j-1];
+      uint64_t* V = &m_directions[64*j];
+      for (size_t k = 0; k < poly.s; k++) V[k] = (uint64_t)poly.m[k] << (63-k);
+      for (size_t k = poly.s; k < 64; k++) {
+         V[k] = V[k-poly.s] ^ (V[k-poly.s] >> poly.s);
+         for (size_t i = 1; i < poly.s; i++) {
+            if ((poly.a >> (poly.s-1-i)) & 1) V[k] ^= V[k-i];
+         }
+      }
+   }
+   skip_to(0);
+}
+
+void Sobol::skip_to(const uint64_t index) {
+   // point n is the XOR of the directions picked out by the bits of n's Gray code
+   const uint64_t gray = index ^ (index >> 1);
+   m_state.assign(m_N_dims, 0);
+   for (size_t j = 0; j < m_N_dims; j++) {
+      for (size_t k = 0; k < 64; k++) {
+         if ((gray >> k) & 1) m_state[j] ^= m_directions[64*j + k];
+      }
+   }
+   m_index = index;
+}
+
+void Sobol::next(/*output*/ double* point) {
+   for (size_t j = 0; j < m_N_dims; j++) point[j] = to_unit(m_state[j] ^ m_shift[j]);
+   // consecutive Gray codes differ in one bit, the lowest zero bit of the index
+   const size_t k = __builtin_ctzll(~m_index);
+   for (size_t j = 0; j < m_N_dims; j++) m_state[j] ^= m_directions[64*j + k];
+   m_index++;
+}
+
+
+
+Halton::Halton(const size_t N_dims) : m_N_dims(N_dims) {
+   initialise(nullptr);
+}
+
+Halton::Halton(const size_t N_dims, Xoshiro256& rng) : m_N_dims(N_dims) {
+   initialise(&rng);
+}
+
+void Halton::initialise(Xoshiro256* rng) {
+   ASSERT( m_N_dims >= 1 && m_N_dims <= HALTON_MAX_DIMS );
+   m_bases.assign(PRIMES, PRIMES + m_N_dims);
+   m_N_digits.resize(m_N_dims);
+   m_permutations.resize(m_N_dims);
+   for (size_t j = 0; j < m_N_dims; j++) {
+      const uint32_t b = m_bases[j];
+      m_N_digits[j] = (size_t)ceil(53.0 * log(2.0) / log((double)b));
+      m_permutations[j].resize(m_N_digits[j], std::vector<uint32_t>(b));
+      for (auto& permutation : m_permutations[j]) {
+         for (uint32_t d = 0; d < b; d++) permutation[d] = d;
+         // Fisher-Yates, or left as the identity for the plain sequence
+         for (uint32_t d = b-1; rng != nullptr && d > 0; d--) std::swap(permutation[d], permutation[rng->below(d+1)]);
+      }
+   }
+   m_index = 0;
+}
+
+void Halton::next(/*output*/ double* point) {
+   for (size_t j = 0; j < m_N_dims; j++) {
+      // every digit position is summed, even past the last non-zero digit of n, since the permutation of a 0 may not be 0
+      const uint32_t b = m_bases[j];
+      uint64_t n = m_index;
+      double scale = 1.0 / b, value = 0.0;
+      for (size_t level = 0; level < m_N_digits[j]; level++) {
+         value += m_permutations[j][level][n % b] * scale;
+         n /= b;
+         scale /= b;
+      }
+      point[j] = MIN(value, 1.0 - 1.1102230246251565e-16); // the tail of all b-1 digits can round up to 1
+   }
+   m_index++;
+}
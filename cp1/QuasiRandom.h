@@ -0,0 +1,116 @@
+#ifndef QUASIRANDOM_H
+#define QUASIRANDOM_H
+
+#include <vector>
+#include <stdint.h>
+#include <omp.h>
+#include "Random.h"
+#include "Statistics.h"
+
+/*
+   Low discrepancy sequences: points in [0,1)^N_dims spread out so evenly that the average of a smooth integrand over 
+   N of them converges like (log N)^d/N rather than 1/sqrt(N). The catch is that there's no error estimate from the 
+   points themselves, so both sequences can be randomised (seeded), which keeps them as even as before but makes 
+   each one an independent unbiased estimate. A few randomised copies then give the error the same way independent 
+   Monte Carlo runs do, see qmc_integrate()
+*/
+
+// which sequence qmc_integrate() uses
+enum LowDiscrepancy { 
+   SOBOL,  // base 2 digital net, best for powers of 2 points. Up to SOBOL_MAX_DIMS dimensions
+   HALTON  // radical inverses in the first N_dims primes, any number of points, best in few dimensions
+};
+
+const size_t SOBOL_MAX_DIMS = 21;
+
+/* Sobol's sequence with Joe & Kuo's direction numbers, generated in Gray code order (one XOR per dimension per 
+   point). With a seed every point is XORed with a random 64 bit number per dimension, a random digital shift */
+class Sobol {
+public:
+   Sobol(const size_t N_dims);
+   Sobol(const size_t N_dims, Xoshiro256& rng); // randomised
+
+   void next(/*output*/ double* point);         // N_dims numbers
+   void skip_to(const uint64_t index);          // so next() gives that point, e.g. to split the points between threads
+   size_t dims() const { return m_N_dims; }
+
+private:
+   void initialise();
+
+   size_t m_N_dims;
+   std::vector<uint64_t> m_directions; // 64 per dimension
+   std::vector<uint64_t> m_shift;      // per dimension, 0 if not randomised
+   std::vector<uint64_t> m_state;
+   uint64_t m_index;
+};
+
+/* Halton's sequence: coordinate j of point n is n written in base prime_j with its digits reversed after the point. 
+   With a seed each digit position of each dimension gets its own random permutation of the digits (random digit 
+   scrambling), which also breaks up the correlations that make plain Halton poor beyond ten or so dimensions */
+class Halton {
+public:
+   Halton(const size_t N_dims);
+   Halton(const size_t N_dims, Xoshiro256& rng); // scrambled
+
+   void next(/*output*/ double* point);
+   void skip_to(const uint64_t index) { m_index = index; }
+   size_t dims() const { return m_N_dims; }
+
+private:
+   void initialise(Xoshiro256* rng);
+
+   size_t m_N_dims;
+   std::vector<uint32_t> m_bases;
+   std::vector<size_t> m_N_digits;                           // enough for double precision in each base
+   std::vector<std::vector<std::vector<uint32_t>>> m_permutations; // [dim][digit position][digit]
+   uint64_t m_index;
+};
+
+struct QmcResult {
+   double estimate;    // mean over the randomised replicates
+   double error;       // standard error of that mean, from their spread
+   size_t evaluations; // N_points * N_replicates
+};
+
+// average of f over the next N_points of a Sobol or Halton sequence
+template<class Sequence, class Integrand>
+double qmc_mean(Sequence& sequence, Integrand& f, const size_t N_points) {
+   std::vector<double> point(sequence.dims());
+   double sum = 0.0;
+   for (size_t i = 0; i < N_points; i++) {
+      sequence.next(point.data());
+      sum += f(point.data());
+   }
+   return sum / N_points;
+}
+
+/* Integral of f over the unit cube [0,1)^N_dims, with f(const double* point) returning a double. Each of the 
+   N_replicates is the average of f over N_points of its own randomisation of the sequence (replicate r seeded 
+   from stream r of seed), and the replicates run in parallel, so the answer doesn't depend on the thread count. 
+   8 to 32 replicates is plenty for the error, spend the rest on N_points (a power of 2 for Sobol) */
+template<class Integrand>
+QmcResult qmc_integrate(Integrand f, const size_t N_dims, const size_t N_points, const size_t N_replicates, 
+                        const LowDiscrepancy sequence = SOBOL, const uint64_t seed = 1) {
+   std::vector<double> means(N_replicates);
+   #pragma omp parallel for schedule(dynamic)
+   for (size_t r = 0; r < N_replicates; r++) {
+      // only the sequence in use is made, so its randomisation is all that comes out of the replicate's stream
+      Xoshiro256 rng(seed, r);
+      if (sequence == SOBOL) {
+         Sobol sobol(N_dims, rng);
+         means[r] = qmc_mean(sobol, f, N_points);
+      } else {
+         Halton halton(N_dims, rng);
+         means[r] = qmc_mean(halton, f, N_points);
+      }
+   }
+   RunningStats replicates;
+   replicates.add(means.data(), means.size());
+   QmcResult result;
+   result.estimate    = replicates.mean();
+   result.error       = replicates.error();
+   result.evaluations = N_points * N_replicates;
+   return result;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef CP1_RANDOM_H
+#define CP1_RANDOM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* xoshiro256** (Blackman & Vigna): 256 bits of state, a handful of shifts and rotates per number, and none of 
+   rand()'s global lock or short period. Each stream's state is filled by running splitmix64 over (seed, stream), 
+   so give every independent unit of work (a run, a chunk of samples) its own stream number and the results come 
+   out the same however that work is spread over threads */
+class Xoshiro256 {
+public:
+   Xoshiro256(const uint64_t seed, const uint64_t stream = 0) {
+      uint64_t z = seed ^ splitmix64(stream + 0x632be59bd9b4e019ull);
+      for (int i = 0; i < 4; i++) s[i] = splitmix64(z += 0x9e3779b97f4a7c15ull);
+   }
+
+   static uint64_t splitmix64(uint64_t z) {
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      return z ^ (z >> 31);
+   }
+
+   uint64_t next() {
+      const uint64_t result = rotl(s[1] * 5, 7) * 9;
+      const uint64_t t = s[1] << 17;
+      s[2] ^= s[0];
+      s[3] ^= s[1];
+      s[1] ^= s[2];
+      s[0] ^= s[3];
+      s[2] ^= t;
+      s[3] = rotl(s[3], 45);
+      return result;
+   }
+   double uniform()                   { return (next() >> 11) * (1.0 / 9007199254740992.0); } // [0,1), 53 bits
+   double uniform(double a, double b) { return a + (b-a)*uniform(); }
+   size_t below(const size_t n)       { return (size_t)(uniform() * n); }                     // [0,n)
+
+private:
+   static uint64_t rotl(const uint64_t x, const int k) { return (x << k) | (x >> (64 - k)); }
+   uint64_t s[4];
+};
+
+#endif
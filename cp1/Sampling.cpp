@@ -0,0 +1,266 @@
+#include <math.h>
+#include <string.h>
+#include <limits>
+#include "../global.h"
+#include "../vecmath.h"
+#include "Sampling.h"
+
+namespace {
+// how many random numbers the array versions draw before transforming them
+const size_t FILL_BLOCK = 256;
+
+// a uniform in [0,1) from the top 52 bits by bit operations alone, which vectorise where a 64 bit int to double
+// conversion doesn't before AVX-512
+inline double uniform_from_bits(const uint64_t bits) {
+   const uint64_t one_point_bits = (bits >> 12) | 0x3ff0000000000000ull;
+   double one_point;
+   memcpy(&one_point, &one_point_bits, sizeof(one_point));
+   return one_point - 1.0;
+}
+}
+
+void ExponentialSampler::fill(Xoshiro256& rng, /*output*/ double* samples, const size_t N) const {
+   for (size_t i = 0; i < N; i++) samples[i] = rng.uniform();
+   const double tau = m_tau, scale = m_scale;
+   #pragma omp simd
+   for (size_t i = 0; i < N; i++) samples[i] = -tau * vm_log1p(-samples[i]*scale);
+}
+
+
+
+/*
+   Layer i of a ziggurat is the rectangle [0,x[i]] x [f(x[i]),f(x[i+1])], layer 0 being the base strip plus the 
+   tail beyond r, all of area v. A uniform point in a layer is under the pdf for sure if it's left of x[i+1], which 
+   ratio[i] = x[i+1]/x[i] checks without any function calls. Only the sliver to the right of x[i+1] needs f(x)
+*/
+namespace {
+template<size_t N_layers>
+struct ZigguratTables {
+   double x[N_layers+1];
+   double ratio[N_layers];
+   double f[N_layers+1];
+
+   ZigguratTables(const double r, const double v, double (*pdf)(double), double (*inverse_pdf)(double)) {
+      x[0] = v / pdf(r);
+      x[1] = r;
+      for (size_t i = 2; i < N_layers; i++) x[i] = inverse_pdf(v/x[i-1] + pdf(x[i-1]));
+      x[N_layers] = 0.0;
+      for (size_t i = 0; i < N_layers; i++) ratio[i] = x[i+1] / x[i];
+      for (size_t i = 0; i <= N_layers; i++) f[i] = pdf(x[i]);
+   }
+};
+
+double normal_pdf(double x)          { return exp(-0.5*x*x); }
+double normal_inverse_pdf(double y)  { return sqrt(-2.0*log(y)); }
+double exp_pdf(double x)             { return exp(-x); }
+double exp_inverse_pdf(double y)     { return -log(y); }
+
+const size_t NORMAL_LAYERS = 128;
+const size_t EXP_LAYERS    = 256;
+const double NORMAL_R      = 3.442619855899;
+const double EXP_R         = 7.69711747013104972;
+
+const ZigguratTables<NORMAL_LAYERS>& normal_tables() {
+   static const ZigguratTables<NORMAL_LAYERS> tables(NORMAL_R, 9.91256303526217e-3, normal_pdf, normal_inverse_pdf);
+   return tables;
+}
+const ZigguratTables<EXP_LAYERS>& exp_tables() {
+   static const ZigguratTables<EXP_LAYERS> tables(EXP_R, 3.949659822581572e-3, exp_pdf, exp_inverse_pdf);
+   return tables;
+}
+}
+
+/* the rest of a ziggurat sample once the quick test has failed for the signed uniform u in layer i: the tail or 
+   the wedge. False if that rejects too, and the sample has to start again from scratch */
+static bool normal_slow_path(Xoshiro256& rng, const double u, const size_t i, /*output*/ double* sample) {
+   const ZigguratTables<NORMAL_LAYERS>& t = normal_tables();
+   if (i == 0) {
+      // tail beyond r, by Marsaglia's method
+      double x, y;
+      do {
+         x = log(1.0 - rng.uniform()) / NORMAL_R;
+         y = log(1.0 - rng.uniform());
+      } while (-2.0*y < x*x);
+      *sample = (u < 0.0) ? x - NORMAL_R : NORMAL_R - x;
+      return true;
+   }
+   *sample = u * t.x[i];
+   return t.f[i] + rng.uniform()*(t.f[i+1] - t.f[i]) < normal_pdf(*sample);
+}
+
+static bool exp_slow_path(Xoshiro256& rng, const double u, const size_t i, /*output*/ double* sample) {
+   const ZigguratTables<EXP_LAYERS>& t = exp_tables();
+   if (i == 0) {
+      // the tail is another exponential starting at r
+      *sample = EXP_R + ziggurat_exponential(rng);
+      return true;
+   }
+   *sample = u * t.x[i];
+   return t.f[i] + rng.uniform()*(t.f[i+1] - t.f[i]) < exp_pdf(*sample);
+}
+
+double ziggurat_normal(Xoshiro256& rng) {
+   const ZigguratTables<NORMAL_LAYERS>& t = normal_tables();
+   while (true) {
+      // one 64 bit number: the top 52 bits for a signed uniform, the bottom 7 for the layer
+      const uint64_t bits = rng.next();
+      const double u = 2.0*uniform_from_bits(bits) - 1.0;
+      const size_t i = bits & (NORMAL_LAYERS-1);
+      if (fabs(u) < t.ratio[i]) return u * t.x[i];
+      double sample;
+      if (normal_slow_path(rng, u, i, &sample)) return sample;
+   }
+}
+
+double ziggurat_exponential(Xoshiro256& rng) {
+   const ZigguratTables<EXP_LAYERS>& t = exp_tables();
+   while (true) {
+      const uint64_t bits = rng.next();
+      const double u = uniform_from_bits(bits);
+      const size_t i = bits & (EXP_LAYERS-1);
+      if (u < t.ratio[i]) return u * t.x[i];
+      double sample;
+      if (exp_slow_path(rng, u, i, &sample)) return sample;
+   }
+}
+
+/* The quick test for a whole block at once, in a loop the compiler can vectorise, with a nan left wherever it 
+   failed. Then those few (about 1%) carry on one at a time from the same u and layer, so every sample has been 
+   through exactly the scalar algorithm, just with its random numbers drawn in a different order */
+void ziggurat_normal(Xoshiro256& rng, /*output*/ double* samples, const size_t N) {
+   const ZigguratTables<NORMAL_LAYERS>& t = normal_tables();
+   uint64_t bits[FILL_BLOCK];
+   for (size_t first = 0; first < N; first += FILL_BLOCK) {
+      const size_t M = MIN(FILL_BLOCK, N - first);
+      double* block = samples + first;
+      for (size_t k = 0; k < M; k++) bits[k] = rng.next();
+      #pragma omp simd
+      for (size_t k = 0; k < M; k++) {
+         const double u = 2.0*uniform_from_bits(bits[k]) - 1.0;
+         const size_t i = bits[k] & (NORMAL_LAYERS-1);
+         const double ratio = t.ratio[i], x = t.x[i]; // both loaded for every lane, a masked gather won't vectorise
+         block[k] = (fabs(u) < ratio) ? u * x : NAN;
+      }
+      for (size_t k = 0; k < M; k++) {
+         if (block[k] == block[k]) continue;
+         const double u = 2.0*uniform_from_bits(bits[k]) - 1.0;
+         if (!normal_slow_path(rng, u, bits[k] & (NORMAL_LAYERS-1), &block[k])) block[k] = ziggurat_normal(rng);
+      }
+   }
+}
+
+void ziggurat_exponential(Xoshiro256& rng, /*output*/ double* samples, const size_t N) {
+   const ZigguratTables<EXP_LAYERS>& t = exp_tables();
+   uint64_t bits[FILL_BLOCK];
+   for (size_t first = 0; first < N; first += FILL_BLOCK) {
+      const size_t M = MIN(FILL_BLOCK, N - first);
+      double* block = samples + first;
+      for (size_t k = 0; k < M; k++) bits[k] = rng.next();
+      #pragma omp simd
+      for (size_t k = 0; k < M; k++) {
+         const double u = uniform_from_bits(bits[k]);
+         const size_t i = bits[k] & (EXP_LAYERS-1);
+         const double ratio = t.ratio[i], x = t.x[i];
+         block[k] = (u < ratio) ? u * x : NAN;
+      }
+      for (size_t k = 0; k < M; k++) {
+         if (block[k] == block[k]) continue;
+         const double u = uniform_from_bits(bits[k]);
+         if (!exp_slow_path(rng, u, bits[k] & (EXP_LAYERS-1), &block[k])) block[k] = ziggurat_exponential(rng);
+      }
+   }
+}
+
+
+
+/*
+   Scale the weights so they average 1, then repeatedly pair a bin below 1 with one above: the small bin keeps its 
+   own probability and the rest of its slot goes to the large bin, which loses that much. Every slot ends up with 
+   at most two outcomes
+*/
+AliasTable::AliasTable(const std::vector<double>& weights) : m_probability(weights.size()), m_alias(weights.size()) {
+   ASSERT( !weights.empty() );
+   ASSERT( weights.size() <= (size_t)std::numeric_limits<int>::max() ); // fill() works out slots as ints
+   const size_t N = weights.size();
+   double total = 0.0;
+   for (double w : weights) {
+      ASSERT( w >= 0.0 );
+      total += w;
+   }
+   ASSERT( total > 0.0 );
+
+   std::vector<double> scaled(N);
+   std::vector<size_t> small, large;
+   for (size_t i = 0; i < N; i++) {
+      scaled[i] = weights[i] * N / total;
+      (scaled[i] < 1.0 ? small : large).push_back(i);
+   }
+   while (!small.empty() && !large.empty()) {
+      const size_t s = small.back(), l = large.back();
+      small.pop_back();
+      m_probability[s] = scaled[s];
+      m_alias[s] = l;
+      scaled[l] -= 1.0 - scaled[s];
+      if (scaled[l] < 1.0) {
+         large.pop_back();
+         small.push_back(l);
+      }
+   }
+   // whatever's left is 1 to within rounding
+   for (size_t i : small) { m_probability[i] = 1.0; m_alias[i] = i; }
+   for (size_t i : large) { m_probability[i] = 1.0; m_alias[i] = i; }
+}
+
+size_t AliasTable::operator()(Xoshiro256& rng) const {
+   // the whole part of u*N picks the slot, the fractional part chooses between it and its alias
+   const double u = rng.uniform() * m_probability.size();
+   const size_t slot = MIN((size_t)u, m_probability.size()-1);
+   return (u - slot < m_probability[slot]) ? slot : m_alias[slot];
+}
+
+// the uniforms first, then the slot and alias lookups for all of them in a loop the compiler can vectorise
+void AliasTable::fill(Xoshiro256& rng, /*output*/ size_t* samples, const size_t N) const {
+   const double* probability = m_probability.data();
+   const size_t* alias = m_alias.data();
+   const double N_slots = m_probability.size();
+   const int last_slot = (int)m_probability.size() - 1;
+   double u[FILL_BLOCK];
+   for (size_t first = 0; first < N; first += FILL_BLOCK) {
+      const size_t M = MIN(FILL_BLOCK, N - first);
+      for (size_t k = 0; k < M; k++) u[k] = rng.uniform() * N_slots;
+      #pragma omp simd
+      for (size_t k = 0; k < M; k++) {
+         const int slot = MIN((int)u[k], last_slot); // int because a double to 32 bit int conversion vectorises
+         const size_t other = alias[slot];              // loaded for every lane, as a masked gather won't vectorise
+         samples[first+k] = (u[k] - slot < probability[slot]) ? (size_t)slot : other;
+      }
+   }
+}
+
+std::vector<double> TabulatedSampler::bin_weights(const std::vector<double>& bin_edges, const std::vector<double>& pdf) {
+   ASSERT( bin_edges.size() == pdf.size()+1 );
+   std::vector<double> weights(pdf.size());
+   for (size_t i = 0; i < pdf.size(); i++) weights[i] = pdf[i] * (bin_edges[i+1] - bin_edges[i]);
+   return weights;
+}
+
+TabulatedSampler::TabulatedSampler(const std::vector<double>& bin_edges, const std::vector<double>& pdf) 
+      : m_edges(bin_edges), m_bins(bin_weights(bin_edges, pdf)) { }
+
+double TabulatedSampler::operator()(Xoshiro256& rng) const {
+   const size_t i = m_bins(rng);
+   return m_edges[i] + rng.uniform() * (m_edges[i+1] - m_edges[i]);
+}
+
+void TabulatedSampler::fill(Xoshiro256& rng, /*output*/ double* samples, const size_t N) const {
+   const double* edges = m_edges.data();
+   size_t bins[FILL_BLOCK];
+   for (size_t first = 0; first < N; first += FILL_BLOCK) {
+      const size_t M = MIN(FILL_BLOCK, N - first);
+      double* block = samples + first;
+      m_bins.fill(rng, bins, M);
+      for (size_t k = 0; k < M; k++) block[k] = rng.uniform();
+      #pragma omp simd
+      for (size_t k = 0; k < M; k++) block[k] = edges[bins[k]] + block[k] * (edges[bins[k]+1] - edges[bins[k]]);
+   }
+}
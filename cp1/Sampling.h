@@ -0,0 +1,70 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <vector>
+#include <math.h>
+#include "Random.h"
+
+/*
+   Samplers that turn every uniform random number into a sample, instead of rejecting most of them like a box under 
+   the pdf does. Each has a one-at-a-time operator() and a fill() that writes a whole array, drawing all the 
+   random numbers for a block first and then transforming them in one omp simd loop, which vectorises when built 
+   with make ARCH=-march=native (see vecmath.h). The ziggurats finish the few samples their quick test rejects 
+   one at a time afterwards
+*/
+
+// exponential with mean tau by inverting its cdf, optionally cut off at xmax (renormalised, so still exact)
+class ExponentialSampler {
+public:
+   ExponentialSampler(const double tau, const double xmax = INFINITY) 
+      : m_tau(tau), m_scale(-expm1(-xmax/tau)) { }
+
+   double operator()(Xoshiro256& rng) const { return from_uniform(rng.uniform()); }
+   double from_uniform(const double u) const { return -m_tau * log1p(-u*m_scale); } // u in [0,1)
+   void fill(Xoshiro256& rng, /*output*/ double* samples, const size_t N) const;
+
+private:
+   double m_tau;
+   double m_scale; // fraction of the untruncated distribution below xmax
+};
+
+/* Marsaglia & Tsang's ziggurat: the pdf is covered by equal area layers, and a sample from inside a layer's 
+   rectangle (nearly always) needs one random number and no exp/log. Uses 128 layers for the normal and 256 for the 
+   exponential, tables built on first use */
+double ziggurat_normal(Xoshiro256& rng);      // mean 0, sigma 1
+double ziggurat_exponential(Xoshiro256& rng); // mean 1
+void ziggurat_normal(Xoshiro256& rng, /*output*/ double* samples, const size_t N);
+void ziggurat_exponential(Xoshiro256& rng, /*output*/ double* samples, const size_t N);
+
+/* Vose's alias method: any discrete distribution given by (unnormalised) weights, sampled in constant time with 
+   one random number however many outcomes there are */
+class AliasTable {
+public:
+   AliasTable(const std::vector<double>& weights);
+
+   size_t operator()(Xoshiro256& rng) const;
+   void fill(Xoshiro256& rng, /*output*/ size_t* samples, const size_t N) const;
+   size_t size() const { return m_probability.size(); }
+
+private:
+   std::vector<double> m_probability; // of keeping bin i rather than taking its alias
+   std::vector<size_t> m_alias;
+};
+
+/* Any pdf tabulated as a histogram: the bin from an alias table of pdf*width, then uniform within it. Exact for 
+   the piecewise constant pdf, so as good as the tabulation is fine */
+class TabulatedSampler {
+public:
+   TabulatedSampler(const std::vector<double>& bin_edges, const std::vector<double>& pdf);
+
+   double operator()(Xoshiro256& rng) const;
+   void fill(Xoshiro256& rng, /*output*/ double* samples, const size_t N) const;
+
+private:
+   static std::vector<double> bin_weights(const std::vector<double>& bin_edges, const std::vector<double>& pdf);
+
+   std::vector<double> m_edges;
+   AliasTable m_bins;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include <math.h>
+#include "../global.h"
+#include "Statistics.h"
+
+void RunningStats::add(const double x) {
+   if (m_N == 0) {
+      m_min = m_max = x;
+   }
+   else {
+      m_min = MIN(m_min, x);
+      m_max = MAX(m_max, x);
+   }
+   m_N++;
+   const double delta = x - m_mean;
+   m_mean += delta / m_N;
+   m_M2 += delta * (x - m_mean);
+}
+
+void RunningStats::add(const double* x, const size_t N) {
+   for (size_t i = 0; i < N; i++) add(x[i]);
+}
+
+/*
+   With n_a, n_b samples and delta the difference of their means, the combined mean moves delta*n_b/n towards b and 
+   M2 = M2_a + M2_b + delta^2*n_a*n_b/n. Stable even when the two halves are very different sizes
+*/
+void RunningStats::merge(const RunningStats& other) {
+   if (other.m_N == 0) return;
+   if (m_N == 0) {
+      *this = other;
+      return;
+   }
+   const double N = (double)m_N + other.m_N;
+   const double delta = other.m_mean - m_mean;
+   m_mean += delta * other.m_N / N;
+   m_M2 += other.m_M2 + delta*delta * ((double)m_N * other.m_N / N);
+   m_N += other.m_N;
+   m_min = MIN(m_min, other.m_min);
+   m_max = MAX(m_max, other.m_max);
+}
+
+double RunningStats::sigma() const {
+   return sqrt(variance());
+}
+
+double RunningStats::error() const {
+   return (m_N > 0) ? sigma() / sqrt((double)m_N) : 0.0;
+}
+
+
+
+Histogram::Histogram(const double xmin, const double xmax, const size_t N_bins) 
+      : m_xmin(xmin), m_xmax(xmax), m_width((xmax-xmin)/N_bins), m_counts(N_bins, 0), m_underflow(0), m_overflow(0) {
+   ASSERT( N_bins > 0 && xmax > xmin );
+}
+
+void Histogram::add(const double x) {
+   if (x < m_xmin) {
+      m_underflow++;
+   }
+   else if (x >= m_xmax) {
+      m_overflow++;
+   }
+   else {
+      // rounding can put x just under xmax into a bin past the end
+      m_counts[MIN((size_t)((x - m_xmin) / m_width), m_counts.size()-1)]++;
+   }
+}
+
+void Histogram::add(const double* x, const size_t N) {
+   for (size_t i = 0; i < N; i++) add(x[i]);
+}
+
+void Histogram::merge(const Histogram& other) {
+   ASSERT( other.m_counts.size() == m_counts.size() && other.m_xmin == m_xmin && other.m_xmax == m_xmax );
+   for (size_t i = 0; i < m_counts.size(); i++) m_counts[i] += other.m_counts[i];
+   m_underflow += other.m_underflow;
+   m_overflow  += other.m_overflow;
+}
+
+uint64_t Histogram::total() const {
+   uint64_t sum = m_underflow + m_overflow;
+   for (uint64_t c : m_counts) sum += c;
+   return sum;
+}
+
+void Histogram::step_outline(/*output*/ std::vector<double>* x, /*output*/ std::vector<double>* y) const {
+   x->clear();
+   y->clear();
+   x->push_back(m_xmin);
+   y->push_back(0.0);
+   for (size_t i = 0; i < m_counts.size(); i++) {
+      x->push_back(bin_low(i));   y->push_back(m_counts[i]);
+      x->push_back(bin_low(i+1)); y->push_back(m_counts[i]);
+   }
+   x->push_back(m_xmax);
+   y->push_back(0.0);
+}
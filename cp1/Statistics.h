@@ -0,0 +1,64 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <vector>
+#include <stdint.h>
+
+/*
+   Constant memory summaries of a stream of samples, so a run never has to keep its samples to know their mean, 
+   spread or distribution. Both merge exactly as if one had seen the other's samples, which lets each thread (or 
+   each block of runs) keep its own and combine them at the end
+*/
+
+// count, mean and variance by Welford's update, min and max
+class RunningStats {
+public:
+   RunningStats() : m_N(0), m_mean(0.0), m_M2(0.0), m_min(0.0), m_max(0.0) { }
+
+   void add(const double x);
+   void add(const double* x, const size_t N);
+   void merge(const RunningStats& other); // Chan et al's pairwise combination
+
+   uint64_t count() const  { return m_N; }
+   double mean() const     { return m_mean; }
+   double variance() const { return (m_N > 1) ? m_M2 / (m_N - 1) : 0.0; } // sample variance
+   double sigma() const;
+   double error() const;                                                  // on the mean, sigma/sqrt(N)
+   double min() const      { return m_min; }
+   double max() const      { return m_max; }
+
+private:
+   uint64_t m_N;
+   double m_mean;
+   double m_M2;  // sum of squared differences from the mean
+   double m_min, m_max;
+};
+
+// N_bins equal bins over [xmin, xmax), anything outside counted separately
+class Histogram {
+public:
+   Histogram(const double xmin, const double xmax, const size_t N_bins);
+
+   void add(const double x);
+   void add(const double* x, const size_t N);
+   void merge(const Histogram& other); // must have the same binning
+
+   size_t size() const                          { return m_counts.size(); }
+   const std::vector<uint64_t>& counts() const  { return m_counts; }
+   uint64_t underflow() const                   { return m_underflow; }
+   uint64_t overflow() const                    { return m_overflow; }
+   uint64_t total() const;                      // including under/overflow
+   double bin_low(const size_t i) const         { return m_xmin + i*m_width; }
+   double bin_centre(const size_t i) const      { return m_xmin + (i+0.5)*m_width; }
+   double bin_width() const                     { return m_width; }
+
+   // the outline of the bars, for plotting as a line
+   void step_outline(/*output*/ std::vector<double>* x, /*output*/ std::vector<double>* y) const;
+
+private:
+   double m_xmin, m_xmax, m_width;
+   std::vector<uint64_t> m_counts;
+   uint64_t m_underflow, m_overflow;
+};
+
+#endif
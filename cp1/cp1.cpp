@@ -8,74 +8,78 @@
 #include <vector>
 #include <math.h>
 #include <numeric>
+#include <algorithm>
 #include <sstream>
 
 #include "functions.h"
+#include "MonteCarlo.h"
+#include "Sampling.h"
+#include "Statistics.h"
+#include "QuasiRandom.h"
 #include "../matplotlibcpp.h"
 namespace plt = matplotlibcpp;
 
-int main(int argc, char** argv) {
-   srand(time(NULL));
+// what's kept of every run: its mean decay time, summarised and binned
+struct RunSummary {
+   RunningStats lifetimes;
+   Histogram histogram;
+
+   RunSummary(const double xmin, const double xmax, const size_t N_bins) : histogram(xmin, xmax, N_bins) { }
+   void add(const double lifetime)         { lifetimes.add(lifetime); histogram.add(lifetime); }
+   void merge(const RunSummary& other)     { lifetimes.merge(other.lifetimes); histogram.merge(other.histogram); }
+};
 
+int main(int argc, char** argv) {
    double tau = 2.2; // microseconds
 
    int n_tests_per_run = 1000;
    int n_runs          = (argc > 1) ? std::stoi(argv[1]) : 500;
+   uint64_t seed       = (argc > 2) ? std::stoull(argv[2]) : time(NULL); // same seed = same results
 
    // limits of the monte-carlo number generation from muon_pdf()
    double xmin = 0.0;
    double xmax = 10.0*tau;
-   double ymin = 0.0;
-   double ymax = muon_pdf(xmin, tau);
-
-   std::vector<double> average_lifetimes(n_runs);
-   std::vector<double> single_run_decay_times(n_tests_per_run);
-
-
-   for (int i = 0; i < n_runs; i++) {
-      // prints current running percentage
-      printf("\rRunning: %.2f%%", i*100.0/(float)n_runs);
-
-      std::vector<double> points_x(n_tests_per_run), points_y(n_tests_per_run); // generated points under the pdf
-      double running_total = 0.0; // sum of all decay times that are considered in the simulated mean
-
-      for (int j = 0; j < n_tests_per_run; j++) {
-         bool has_found_point_under_line = false;
-         while (!has_found_point_under_line) {
-            double x           = random_in_range(xmin, xmax);
-            double y_pdf       = muon_pdf(x, tau);
-            double y_generated = random_in_range(ymin, ymax);
-            // if the generated point is under the pdf line
-            if (y_generated < y_pdf) {
-               points_x[j] = x; // add the x/y coords to the arrays
-               points_y[j] = y_generated;
-               running_total += x; // used to calculate mean decay time at the end
-               has_found_point_under_line = true;
-            }
-            // otherwise just try again
-         }
-         if (i == 0) {
-            single_run_decay_times[j] = points_x[j];
-         }
+
+   // every run on its own random stream, spread over all the cores
+   MonteCarlo engine(seed);
+   printf("Running %d runs on %zu threads, seed %llu\n", n_runs, engine.threads(), (unsigned long long)seed);
+   const ExponentialSampler decay_time(tau, xmax); // inverse cdf, so every random number is a decay time
+
+   // nothing is stored per sample or per run, only these running summaries
+   int number_of_bins = 70;
+   const double sigma_expected = tau / sqrt(n_tests_per_run); // of the mean of n exponential samples
+   RunSummary prototype(tau - 5.0*sigma_expected, tau + 5.0*sigma_expected, number_of_bins);
+   Histogram single_run_decay_times(xmin, xmax, number_of_bins);
+   RunningStats single_run_lifetime;
+
+   RunSummary all_runs = engine.accumulate(n_runs, prototype, [&](size_t run, Xoshiro256& rng, RunSummary* summary) {
+      RunningStats lifetime;
+      double decay_times[256];
+      for (int done = 0; done < n_tests_per_run; done += 256) {
+         const size_t N = std::min(256, n_tests_per_run - done);
+         decay_time.fill(rng, decay_times, N);
+         lifetime.add(decay_times, N);
+         if (run == 0) single_run_decay_times.add(decay_times, N); // kept to plot
       }
-      // mean lifetime of the muon for this run
-      average_lifetimes[i] = running_total / (double)n_tests_per_run;
-   }
+      if (run == 0) single_run_lifetime = lifetime;
+      summary->add(lifetime.mean());
+   });
 
 
 
-   int number_of_bins = 70;
    // exponential decay
    {
       // mean of the plotted decay curve
-      double mu = average_lifetimes[0];
-      printf("\rExponential Decay Curve:        \n");
+      double mu = single_run_lifetime.mean();
+      printf("Exponential Decay Curve:\n");
       printf("\tExpected decay time  = %.4f microseconds\n", tau);
       printf("\tSimulated decay time = %.4f microseconds\n", mu);
       printf("\tDifference           = %.4f microseconds\n\n", abs(mu-tau));
 
       // plot of exponential decay
-      plt::hist(single_run_decay_times, number_of_bins, "b", 0.3);
+      std::vector<double> bars_x, bars_y;
+      single_run_decay_times.step_outline(&bars_x, &bars_y);
+      plt::named_plot("Simulated decay times", bars_x, bars_y, "b-");
 
       double y_maximum = 0.12 * n_tests_per_run;
       plt::named_plot("Expected mean", {tau, tau}, {0, y_maximum}, "r--");
@@ -102,18 +106,22 @@ int main(int argc, char** argv) {
    // gaussian distribution
    {
       // calculating mean and error in the simulated distribution
-      double mu = std::accumulate(average_lifetimes.begin(), average_lifetimes.end(), 0.0) / average_lifetimes.size();
-      double sigma = 0.0;
-      for (auto& a : average_lifetimes)
-         sigma += pow(a-mu, 2);
-      sigma = sqrt(sigma / (average_lifetimes.size()-1));
+      double mu    = all_runs.lifetimes.mean();
+      double sigma = all_runs.lifetimes.sigma();
       printf("Distribution of all exponential decay curves:\n");
       printf("\tExpected decay time  = %.4f microseconds\n", tau);
       printf("\tSimulated decay time = %.4f +- %.4f microseconds\n", mu, sigma);
       printf("\t                     = %.4f sigma from expected\n", abs(mu - tau)/sigma);
+      printf("\t                     = %.4f standard errors from expected\n", abs(mu - tau)/all_runs.lifetimes.error());
+      if (all_runs.histogram.underflow() + all_runs.histogram.overflow() > 0) {
+         printf("\t%llu runs outside the histogram\n", 
+                (unsigned long long)(all_runs.histogram.underflow() + all_runs.histogram.overflow()));
+      }
 
       // plot of average decay time probability
-      plt::hist(average_lifetimes, number_of_bins, "b", 0.3);
+      std::vector<double> bars_x, bars_y;
+      all_runs.histogram.step_outline(&bars_x, &bars_y);
+      plt::named_plot("Simulated mean decay times", bars_x, bars_y, "b-");
 
       // two dashed lines indicating the expected/simulated mean decay times
       double y_maximum = 1.1 * 0.05 * n_runs;
@@ -134,4 +142,26 @@ int main(int argc, char** argv) {
       plt::ylim(0.0, y_maximum);
       plt::show();
    }
+
+
+
+
+   // the mean decay time again, as the integral of the inverse cdf over [0,1) with quasi-random points
+   {
+      // same number of decay times as all the runs together, in 16 randomised replicates for the error
+      const size_t N_replicates = 16;
+      const size_t N_points = (size_t)n_runs * n_tests_per_run / N_replicates;
+      auto lifetime = [&](const double* u) { return decay_time.from_uniform(u[0]); };
+      QmcResult sobol  = qmc_integrate(lifetime, 1, N_points, N_replicates, SOBOL, seed);
+      QmcResult halton = qmc_integrate(lifetime, 1, N_points, N_replicates, HALTON, seed);
+
+      // cut off at xmax, so a little under tau
+      const double truncated_mean = tau - xmax * exp(-xmax/tau) / -expm1(-xmax/tau);
+      printf("Quasi-Monte Carlo mean decay time, %zu points:\n", sobol.evaluations);
+      printf("\tExpected decay time  = %.8f microseconds\n", truncated_mean);
+      printf("\tSobol                = %.8f +- %.2e microseconds\n", sobol.estimate, sobol.error);
+      printf("\tHalton               = %.8f +- %.2e microseconds\n", halton.estimate, halton.error);
+      printf("\tMonte Carlo          = %.8f +- %.2e microseconds\n", 
+             all_runs.lifetimes.mean(), all_runs.lifetimes.error());
+   }
 }
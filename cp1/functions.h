@@ -1,6 +1,4 @@
-double random_in_range(double min_val, double max_val) {
-    return min_val + (max_val-min_val) * (double)rand()/RAND_MAX;
-}
+#include "../vecmath.h"
 
 double muon_pdf(double x, double tau) {
    return (1.0/tau) * exp(-x/tau);
@@ -13,11 +11,12 @@ CoordsArray gaussian(double mu, double sigma, unsigned n_runs, double xmin, doub
    std::vector<double> x(N_points), y(N_points);
    for (int i = 0; i < N_points; i++) {
       x[i] = xmin + i*(xmax-xmin)/(double)N_points;
-
-      // n_runs * 0.045 because this gives (more or less) the peak of the histogram
-      double exponent = 0.5 * pow((x[i]-mu)/sigma, 2.0);
-      y[i] = n_runs * 0.045 * exp( -exponent );
+      double z = (x[i]-mu)/sigma;
+      y[i] = -0.5 * z*z;
    }
+   vm_exp(y.data(), y.data(), N_points);
+   // n_runs * 0.045 because this gives (more or less) the peak of the histogram
+   for (int i = 0; i < N_points; i++) y[i] *= n_runs * 0.045;
    return std::make_pair(x, y);
 }
 
@@ -26,7 +25,9 @@ CoordsArray exp_decay(double tau, unsigned n_runs, double xmin, double xmax) {
    std::vector<double> x(N_points), y(N_points);
    for (int i = 0; i < N_points; i++) {
       x[i] = xmin + i*(xmax-xmin)/(double)N_points;
-      y[i] = n_runs * 0.21 * muon_pdf(x[i], tau);
+      y[i] = -x[i]/tau;
    }
+   vm_exp(y.data(), y.data(), N_points); // muon_pdf() for every x at once
+   for (int i = 0; i < N_points; i++) y[i] *= n_runs * 0.21 / tau;
    return std::make_pair(x, y);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <string>
 
 #include "../global.h"
+#include "../vecmath.h"
 #include "Points.h"
 #include "PNJunction.h"
 
@@ -33,17 +34,26 @@ void PNJunction::initialise_points() {
    // finding where x0 fits into the range and saving that array index
    this->m_x0index = (m_x0-m_limit0)/(m_limit4-m_limit0) * m_N_points;
 
-   // fill out the points
+   // fill out the points. Same as rho(), but working out both shapes at every point and picking one afterwards
+   // leaves nothing to branch on, so this vectorises
+   double* x = m_rho_points.x.data();
+   double* y = m_rho_points.y.data();
+   const double x0 = m_x0, delta = m_delta, limit1 = m_limit1, limit2 = m_limit2, limit3 = m_limit3;
+   const int x0index = m_x0index;
+   #pragma omp simd
    for (int i = 0; i < m_N_points; i++) {
-      m_rho_points.x[i] = m_x0 + (i - m_x0index)*m_delta;
-      m_rho_points.y[i] = rho(m_rho_points.x[i]);
+      x[i] = x0 + (i - x0index)*delta;
+      const double negative =  rho_shape(limit1, limit2, x[i]);
+      const double positive = -rho_shape(limit3, limit2, x[i]);
+      const double inside   = (x[i] < limit2) ? negative : positive;
+      y[i] = (x[i] < limit1) ? 0.0 : ((x[i] < limit3) ? inside : 0.0);
    }
    m_rho_points.name = "rho";
 }
 
 double PNJunction::rho_shape(double x0, double x1, double x) const {
    double z = (x - x0) / (x1 - x0);
-   return pow(z,2) * (exp(1-z)-1) / 0.18;
+   return z*z * (vm_exp(1-z)-1) / 0.18;
 }
 
 double PNJunction::rho(double x) const {
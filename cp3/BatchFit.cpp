@@ -0,0 +1,37 @@
+#include <cmath>
+#include <omp.h>
+#include "BatchFit.h"
+
+std::vector<FitResult> fit_many(const Minimiser& config, 
+                                const std::vector<DataPoints>& datasets, 
+                                const size_t N_workers) {
+   std::vector<FitResult> results(datasets.size());
+   const int N_threads = (N_workers > 0) ? (int)N_workers : omp_get_max_threads();
+
+   #pragma omp parallel num_threads(N_threads)
+   {
+      Minimiser m(config); // one per worker, reused for every dataset it picks up
+      m.set_quiet(true);
+      m.set_observer(nullptr, nullptr); // it'd be called from every worker at once
+      m.set_threads(1);                 // the workers already fill the machine, whatever OMP_MAX_ACTIVE_LEVELS says
+      #pragma omp for schedule(dynamic)
+      for (size_t k = 0; k < datasets.size(); k++) {
+         m.set_datapoints(datasets[k]);
+         m.minimise();
+
+         FitResult& result = results[k];
+         result.name       = datasets[k].name;
+         result.params     = m.get_final_parameters();
+         result.chisq      = m.get_final_value();
+         result.iterations = m.get_iterations();
+         result.telemetry  = m.telemetry();
+         result.errors.assign(result.params.size(), NAN);
+         if (m.covariance(result.params, &result.covariance)) {
+            for (size_t i = 0; i < result.params.size(); i++) {
+               result.errors[i] = sqrt(result.covariance(i,i));
+            }
+         }
+      }
+   }
+   return results;
+}
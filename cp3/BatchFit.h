@@ -0,0 +1,31 @@
+#ifndef BATCHFIT_H
+#define BATCHFIT_H
+
+#include <vector>
+#include <string>
+#include "../global.h"
+#include "DataPoints.h"
+#include "Minimiser.h"
+#include "SquareMatrix.h"
+
+// everything worth keeping from fitting one dataset
+struct FitResult {
+   std::string name;        // of the dataset
+   Params params;           // at the minimum
+   Params errors;           // sqrt of the covariance diagonal, NAN if the hessian wasn't positive definite
+   SquareMatrix covariance; // from the hessian at the minimum
+   double chisq;            // function value at the minimum
+   size_t iterations;       // taken by the local minimisation
+   FitTelemetry telemetry;  // evaluation counts and timings
+};
+
+/* Fits every dataset with a copy of config (model, limits, methods etc all set up as for a normal fit, the data it 
+   was made with is ignored) on a pool of N_workers threads, 0 meaning one per core. Each fit is quiet, has no 
+   observer (each result carries its own telemetry instead) and is given set_threads(1), so its grid search, 
+   minimisation and hessian stay on its worker's thread even with nested parallelism turned on, since there's one 
+   dataset per worker to keep them all busy. Results come back in the same order as the datasets */
+std::vector<FitResult> fit_many(const Minimiser& config, 
+                                const std::vector<DataPoints>& datasets, 
+                                const size_t N_workers = 0);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef CHISQUARED_H
+#define CHISQUARED_H
+
+#include <vector>
+#include "../global.h"
+#include "DataPoints.h"
+#include "ModelFunctions.h"
+
+// number of data points handled together in the blocked kernels below, small enough that a block of x, y and 1/e
+// (6kB) stays in L1 cache while every parameter set is run over it
+const size_t CHISQ_BLOCK = 256;
+
+// 1/e for every point, either the cached copy in the DataPoints or a fresh one in scratch if it hasn't been made
+inline const double* inverse_errors(const DataPoints& data, std::vector<double>* scratch) {
+   if (data.has_inverse_errors()) return data.inv_e.data();
+   scratch->resize(data.e.size());
+   for (size_t i = 0; i < data.e.size(); i++) (*scratch)[i] = 1.0 / data.e[i];
+   return scratch->data();
+}
+
+// sum of squared residuals (y - model)*inv_e over points [first, last), the inner loop of everything below
+template<class Model>
+inline double chisq_block(const double* x, const double* y, const double* inv_e, 
+                          const size_t first, const size_t last, const double* p) {
+   double chisq = 0.0;
+   #pragma omp simd reduction(+:chisq)
+   for (size_t i = first; i < last; i++) {
+      const double chi = (y[i] - Model::value(x[i], p)) * inv_e[i];
+      chisq += chi * chi;
+   }
+   return chisq;
+}
+
+/* chi squared of the data against one of the model structs in ModelFunctions.h. Matches the FunctionToMinimise 
+   typedef (the ModelFunction argument is ignored, the model is the template argument instead), so it can be handed
+   straight to Minimiser. With the model inlined there's no call or size check per point, and using the cached 1/e
+   the loop body is a handful of multiply-adds which the simd pragma lets the compiler vectorise, sum and all */
+template<class Model>
+double model_chisq(const DataPoints& data, const Params& params, ModelFunction) {
+   ASSERT( params.size() == Model::N );
+   double p[Model::N];
+   for (size_t j = 0; j < Model::N; j++) p[j] = params[j];
+
+   std::vector<double> scratch;
+   const double* inv_e = inverse_errors(data, &scratch);
+   return chisq_block<Model>(data.x.data(), data.y.data(), inv_e, 0, data.x.size(), p);
+}
+
+/* chi squared for N_sets parameter vectors at once, stored one after another in params (N_sets*Model::N values),
+   with one result per set written to chisq. The data is walked once in blocks of CHISQ_BLOCK points and every set
+   is run over each block while it's still in cache, so for big datasets this is much quicker than N_sets separate
+   model_chisq() calls. Matches the BatchFunctionToMinimise typedef, used by the grid search */
+template<class Model>
+void model_chisq_many(const DataPoints& data, const double* params, const size_t N_sets, double* chisq) {
+   std::vector<double> scratch;
+   const double* inv_e = inverse_errors(data, &scratch);
+   const double* x = data.x.data();
+   const double* y = data.y.data();
+   const size_t N_points = data.x.size();
+
+   for (size_t k = 0; k < N_sets; k++) chisq[k] = 0.0;
+   for (size_t first = 0; first < N_points; first += CHISQ_BLOCK) {
+      const size_t last = MIN( first + CHISQ_BLOCK, N_points );
+      for (size_t k = 0; k < N_sets; k++) {
+         chisq[k] += chisq_block<Model>(x, y, inv_e, first, last, params + k*Model::N);
+      }
+   }
+}
+
+#endif
@@ -1,29 +1,40 @@
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omp.h>
 #include "../global.h"
 #include "DataPoints.h"
+#include "NumberParser.h"
 
 DataPoints::DataPoints() {
    //blank
 }
 
 DataPoints::DataPoints(const std::string& filename, const std::string& dataset_name) {
-   std::ifstream file(filename);
-   ASSERT( file.good() );
-   std::string temp_str;
-   while (std::getline(file, temp_str)) {
-      std::stringstream ss(temp_str);
-      double temp;
-      ss >> temp;
-      x.push_back(temp);
-      ss >> temp;
-      y.push_back(temp);
-      ss >> temp;
-      e.push_back(temp);
-   }
+   read_text(filename);
    name = dataset_name;
+   update_inverse_errors();
+}
+
+DataPoints DataPoints::load_cached(const std::string& filename, const std::string& dataset_name) {
+   const std::string cache_filename = filename + ".cache";
+   DataPoints data;
+   if (!data.read_cache(cache_filename, filename)) {
+      data.read_text(filename);
+      if (!data.write_cache(cache_filename, filename)) {
+         printf("Couldn't write %s, carrying on without it\n", cache_filename.c_str());
+      }
+   }
+   data.name = dataset_name;
+   data.update_inverse_errors();
+   return data;
 }
 
 DataPoints::DataPoints(const DataPoints& dp) 
-   : x(dp.x), y(dp.y), e(dp.e), name(dp.name) { }
+   : x(dp.x), y(dp.y), e(dp.e), inv_e(dp.inv_e), name(dp.name) { }
 
 DataPoints::DataPoints(const XArray& X, 
                        const Params& params, 
@@ -44,4 +55,169 @@ DataPoints::DataPoints(const size_t N_points) {
    y.resize(N_points, 0);
    e.resize(N_points, 0);
    name = "";
+}
+
+void DataPoints::update_inverse_errors() {
+   inv_e.resize(e.size());
+   for (size_t i = 0; i < e.size(); i++) {
+      inv_e[i] = 1.0 / e[i];
+   }
+}
+
+void DataPoints::append(const DataPoints& more) {
+   const bool had_inverse_errors = has_inverse_errors() || x.empty();
+   x.insert(x.end(), more.x.begin(), more.x.end());
+   y.insert(y.end(), more.y.begin(), more.y.end());
+   e.insert(e.end(), more.e.begin(), more.e.end());
+   if (had_inverse_errors) {
+      inv_e.reserve(e.size());
+      for (const double error : more.e) inv_e.push_back(1.0 / error);
+   }
+}
+
+// finds the end of the line starting at p, returning whether it has anything other than whitespace on it
+static bool next_line(const char* p, const char* end, /*output*/ const char** line_end) {
+   const char* newline = (const char*)memchr(p, '\n', end - p);
+   *line_end = (newline == nullptr) ? end : newline;
+   for (; p < *line_end; p++) {
+      if (!is_blank(*p)) return true;
+   }
+   return false;
+}
+
+/* The file is mmapped and cut into a few chunks per thread, each boundary moved up to the start of a line. One 
+   parallel pass counts the points in each chunk so x/y/e can be sized exactly and every chunk knows where its points 
+   go, then a second parallel pass parses them straight into place */
+void DataPoints::read_text(const std::string& filename) {
+   x.clear(); 
+   y.clear(); 
+   e.clear();
+   const int fd = open(filename.c_str(), O_RDONLY);
+   ASSERT( fd >= 0 );
+   struct stat file_info;
+   ASSERT( fstat(fd, &file_info) == 0 );
+   const size_t size = file_info.st_size;
+   if (size == 0) {
+      close(fd);
+      return;
+   }
+   void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+   ASSERT( mapped != MAP_FAILED );
+   madvise(mapped, size, MADV_SEQUENTIAL);
+   const char* text = (const char*)mapped;
+   const char* end  = text + size;
+
+   const size_t min_chunk_size = 1 << 16; // not worth splitting the small files
+   const size_t N_chunks = MAX( MIN( (size_t)omp_get_max_threads()*4, size/min_chunk_size ), (size_t)1 );
+   std::vector<const char*> bounds(N_chunks+1);
+   bounds[0] = text;
+   bounds[N_chunks] = end;
+   for (size_t k = 1; k < N_chunks; k++) {
+      const char* b = MAX( text + size*k/N_chunks, bounds[k-1] );
+      while (b < end && b[-1] != '\n') b++;
+      bounds[k] = b;
+   }
+
+   // count the points in each chunk, then turn the counts into the index of each chunk's first point
+   std::vector<size_t> first_point(N_chunks+1, 0);
+   #pragma omp parallel for schedule(dynamic)
+   for (size_t k = 0; k < N_chunks; k++) {
+      size_t count = 0;
+      const char* line_end;
+      for (const char* p = bounds[k]; p < bounds[k+1]; p = line_end+1) {
+         if (next_line(p, bounds[k+1], &line_end)) count++;
+      }
+      first_point[k+1] = count;
+   }
+   for (size_t k = 0; k < N_chunks; k++) {
+      first_point[k+1] += first_point[k];
+   }
+   const size_t N_points = first_point[N_chunks];
+   x.resize(N_points);
+   y.resize(N_points);
+   e.resize(N_points);
+
+   bool all_parsed = true;
+   #pragma omp parallel for schedule(dynamic) reduction(&&:all_parsed)
+   for (size_t k = 0; k < N_chunks; k++) {
+      size_t i = first_point[k];
+      const char* line_end;
+      for (const char* p = bounds[k]; p < bounds[k+1]; p = line_end+1) {
+         if (!next_line(p, bounds[k+1], &line_end)) continue;
+         const char* c = p;
+         const bool parsed = parse_double(&c, line_end, &x[i]) 
+                          && parse_double(&c, line_end, &y[i]) 
+                          && parse_double(&c, line_end, &e[i]);
+         all_parsed = all_parsed && parsed;
+         i++;
+      }
+   }
+   munmap(mapped, size);
+   close(fd);
+   ASSERT( all_parsed ); // every non-blank line needs at least three numbers on it
+}
+
+// start of a cache file, followed by N_points each of x, y and e
+struct CacheHeader {
+   char magic[8];
+   uint64_t N_points;
+   int64_t source_size;  // these have to match the text file for the cache to be used
+   int64_t source_mtime;
+   int64_t source_mtime_ns; // so an edit that keeps the size within the same second still counts
+};
+static const char cache_magic[8] = { 'D','P','C','A','C','H','E','2' };
+
+bool DataPoints::write_cache(const std::string& cache_filename, const std::string& source_filename) const {
+   struct stat source_info;
+   if (stat(source_filename.c_str(), &source_info) != 0) return false;
+   CacheHeader header;
+   memcpy(header.magic, cache_magic, sizeof(cache_magic));
+   header.N_points     = x.size();
+   header.source_size  = source_info.st_size;
+   header.source_mtime = source_info.st_mtim.tv_sec;
+   header.source_mtime_ns = source_info.st_mtim.tv_nsec;
+
+   // written under a temporary name and moved into place so nobody can read half a cache
+   const std::string temp_filename = cache_filename + ".tmp";
+   FILE* file = fopen(temp_filename.c_str(), "wb");
+   if (file == nullptr) return false;
+   const bool written = fwrite(&header, sizeof(header), 1, file) == 1
+                     && fwrite(x.data(), sizeof(double), x.size(), file) == x.size()
+                     && fwrite(y.data(), sizeof(double), y.size(), file) == y.size()
+                     && fwrite(e.data(), sizeof(double), e.size(), file) == e.size();
+   if (fclose(file) != 0 || !written) {
+      remove(temp_filename.c_str());
+      return false;
+   }
+   return rename(temp_filename.c_str(), cache_filename.c_str()) == 0;
+}
+
+bool DataPoints::read_cache(const std::string& cache_filename, const std::string& source_filename) {
+   struct stat source_info;
+   if (stat(source_filename.c_str(), &source_info) != 0) return false;
+   FILE* file = fopen(cache_filename.c_str(), "rb");
+   if (file == nullptr) return false;
+
+   // N_points is checked against the cache's own size before anything is allocated from it
+   struct stat cache_info;
+   CacheHeader header;
+   bool valid = fstat(fileno(file), &cache_info) == 0
+             && fread(&header, sizeof(header), 1, file) == 1
+             && memcmp(header.magic, cache_magic, sizeof(cache_magic)) == 0
+             && header.source_size  == (int64_t)source_info.st_size
+             && header.source_mtime == (int64_t)source_info.st_mtim.tv_sec
+             && header.source_mtime_ns == (int64_t)source_info.st_mtim.tv_nsec
+             && header.N_points == ((uint64_t)cache_info.st_size - sizeof(header)) / (3*sizeof(double))
+             && (uint64_t)cache_info.st_size == sizeof(header) + header.N_points*3*sizeof(double);
+   if (valid) {
+      const size_t N = header.N_points;
+      x.resize(N);
+      y.resize(N);
+      e.resize(N);
+      valid = fread(x.data(), sizeof(double), N, file) == N
+           && fread(y.data(), sizeof(double), N, file) == N
+           && fread(e.data(), sizeof(double), N, file) == N;
+   }
+   fclose(file);
+   return valid;
 }
\ No newline at end of file
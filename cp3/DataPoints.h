@@ -11,6 +11,7 @@ public:
    XArray x;
    YArray y;
    EArray e;
+   EArray inv_e; // 1/e for each point, so chi squared can multiply rather than divide. Empty until computed
    std::string name;
 
    // empty
@@ -20,6 +21,11 @@ public:
    DataPoints(const std::string& filename, 
               const std::string& dataset_name);
 
+   // same as above, but goes through a binary copy at filename+".cache" which is made on the first call and reused
+   // for as long as the text file keeps the same size and modification time
+   static DataPoints load_cached(const std::string& filename, 
+                                 const std::string& dataset_name);
+
    // clone another object
    DataPoints(const DataPoints& dp);
    
@@ -31,6 +37,15 @@ public:
    
    // just allocate the space, nothing more
    DataPoints(const size_t N_points);
+
+   // fill inv_e from e. Done automatically when reading a file, call it again after changing e by hand
+   void update_inverse_errors();
+   bool has_inverse_errors() const { return inv_e.size() == e.size() && !e.empty(); }
+
+   void append(const DataPoints& more); // add more's points on the end, keeping inv_e up to date if it's there
+   void read_text(const std::string& filename); // columns of x y e, one point per line, blank lines skipped
+   bool write_cache(const std::string& cache_filename, const std::string& source_filename) const;
+   bool read_cache(const std::string& cache_filename, const std::string& source_filename); // false if missing/stale
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "LinearLeastSquares.h"
+
+// x^0, x^1, ... x^(N-1)
+struct PowerBasis {
+   size_t N;
+   void operator()(const double x, double* phi) const {
+      double x_to_the_j = 1.0;
+      for (size_t j = 0; j < N; j++) {
+         phi[j] = x_to_the_j;
+         x_to_the_j *= x;
+      }
+   }
+};
+
+bool polynomial_least_squares(const DataPoints& data, 
+                              const size_t N_params,
+                   /*output*/ Params* params, 
+                   /*output*/ SquareMatrix* covariance,
+                   /*output*/ double* chisq) {
+   ASSERT( N_params >= 1 );
+   PowerBasis basis;
+   basis.N = N_params;
+   return basis_least_squares(data, N_params, basis, params, covariance, chisq);
+}
@@ -0,0 +1,109 @@
+#ifndef LINEARLEASTSQUARES_H
+#define LINEARLEASTSQUARES_H
+
+#include <vector>
+#include <omp.h>
+#include "../global.h"
+#include "DataPoints.h"
+#include "SquareMatrix.h"
+#include "ChiSquared.h"
+#include "ModelFunctions.h"
+
+/* Weighted linear least squares for any model of the form y = p_0*phi_0(x) + p_1*phi_1(x) + ..., where basis(x, phi)
+   fills phi with the N_params basis function values at x. Minimising chisq then just means solving the normal 
+   equations A*p = b, with A = sum phi*phi^T/e^2 and b = sum y*phi/e^2, and the parameter covariance is A^-1. 
+   Everything comes from one parallel pass over the data (each thread sums its own A and b) and a Cholesky 
+   solve, no starting point, limits or iteration needed. Returns false if A isn't positive definite, i.e. the basis
+   functions aren't independent over these x values */
+template<class Basis>
+bool basis_least_squares(const DataPoints& data, 
+                         const size_t N_params,
+                         Basis basis,
+              /*output*/ Params* params,
+              /*output*/ SquareMatrix* covariance,
+              /*output*/ double* chisq = nullptr) {
+   std::vector<double> scratch;
+   const double* inv_e = inverse_errors(data, &scratch);
+   const size_t N_points = data.x.size();
+   const size_t N_threads = omp_get_max_threads();
+   std::vector<double> thread_A(N_threads * N_params * N_params, 0.0);
+   std::vector<double> thread_b(N_threads * N_params, 0.0);
+
+   #pragma omp parallel num_threads(N_threads)
+   {
+      double* A = &thread_A[omp_get_thread_num() * N_params * N_params];
+      double* b = &thread_b[omp_get_thread_num() * N_params];
+      std::vector<double> phi(N_params);
+      #pragma omp for schedule(static)
+      for (size_t i = 0; i < N_points; i++) {
+         basis(data.x[i], phi.data());
+         const double w = inv_e[i] * inv_e[i];
+         for (size_t j = 0; j < N_params; j++) {
+            const double w_phi = w * phi[j];
+            b[j] += w_phi * data.y[i];
+            for (size_t k = 0; k <= j; k++) A[j*N_params + k] += w_phi * phi[k];
+         }
+      }
+   }
+
+   // add up the threads' sums in a fixed order
+   SquareMatrix A(N_params, 0.0);
+   Params b(N_params, 0.0);
+   for (size_t t = 0; t < N_threads; t++) {
+      for (size_t j = 0; j < N_params; j++) {
+         b[j] += thread_b[t*N_params + j];
+         for (size_t k = 0; k <= j; k++) A(j,k) += thread_A[(t*N_params + j)*N_params + k];
+      }
+   }
+   for (size_t j = 0; j < N_params; j++) {
+      for (size_t k = 0; k < j; k++) A(k,j) = A(j,k);
+   }
+   if (!A.solve(b, params) || !A.inverse(covariance)) return false;
+
+   if (chisq != nullptr) {
+      // worked out from the residuals rather than y^T*W*y - p^T*b, which loses everything to cancellation
+      double sum = 0.0;
+      #pragma omp parallel
+      {
+         std::vector<double> phi(N_params);
+         #pragma omp for reduction(+:sum)
+         for (size_t i = 0; i < N_points; i++) {
+            basis(data.x[i], phi.data());
+            double y = 0.0;
+            for (size_t j = 0; j < N_params; j++) y += (*params)[j] * phi[j];
+            const double chi = (data.y[i] - y) * inv_e[i];
+            sum += chi * chi;
+         }
+      }
+      *chisq = sum;
+   }
+   return true;
+}
+
+/* The basis functions of a model struct from ModelFunctions.h that's linear in its parameters (Linear, Quadratic, 
+   Cubic, Polynomial<D>) are just its gradient, which doesn't depend on the parameters */
+template<class Model>
+struct ModelBasis {
+   void operator()(const double x, double* phi) const {
+      const double zeros[Model::N] = { };
+      Model::gradient(x, zeros, phi);
+   }
+};
+
+// closed form fit of one of the linear-in-parameters model structs, e.g. linear_least_squares<Linear>(data, ...)
+template<class Model>
+bool linear_least_squares(const DataPoints& data, 
+               /*output*/ Params* params, 
+               /*output*/ SquareMatrix* covariance,
+               /*output*/ double* chisq = nullptr) {
+   return basis_least_squares(data, Model::N, ModelBasis<Model>(), params, covariance, chisq);
+}
+
+// same for a polynomial with N_params terms chosen at run time, matching polynomial() in ModelFunctions.h
+bool polynomial_least_squares(const DataPoints& data, 
+                              const size_t N_params,
+                   /*output*/ Params* params, 
+                   /*output*/ SquareMatrix* covariance,
+                   /*output*/ double* chisq = nullptr);
+
+#endif
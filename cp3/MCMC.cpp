@@ -0,0 +1,143 @@
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <omp.h>
+#include "MCMC.h"
+#include "Random.h"
+
+// start of a chain file, followed by records of N_walkers*(N_params+1) doubles, one per saved step
+struct ChainHeader {
+   char magic[8];
+   uint64_t N_params;
+   uint64_t N_walkers;
+};
+static const char chain_magic[8] = { 'M','C','M','C','C','H','N','1' };
+
+EnsembleSampler::EnsembleSampler(const Minimiser& config, const size_t N_walkers, const uint64_t seed) 
+      : m_minimiser(config), m_N_walkers(N_walkers), m_seed(seed), m_stretch(2.0), m_step(0), 
+        m_N_accepted(0), m_N_proposed(0) {
+   ASSERT( N_walkers >= 4 && N_walkers % 2 == 0 ); // two equal halves, each with at least two walkers
+   m_minimiser.set_quiet(true);
+}
+
+void EnsembleSampler::set_limits(const Params& pmin, const Params& pmax) {
+   ASSERT( pmin.size() == pmax.size() );
+   m_limits_min = pmin;
+   m_limits_max = pmax;
+}
+
+double EnsembleSampler::log_posterior(const Params& params) const {
+   for (size_t j = 0; j < m_limits_min.size(); j++) {
+      if (params[j] < MIN(m_limits_min[j], m_limits_max[j]) || params[j] > MAX(m_limits_min[j], m_limits_max[j])) {
+         return -INFINITY;
+      }
+   }
+   const double chisq = m_minimiser.function_value(params);
+   return std::isfinite(chisq) ? -0.5*chisq : -INFINITY;
+}
+
+void EnsembleSampler::initialise(const Params& centre, const Params& spread) {
+   ASSERT( centre.size() == spread.size() );
+   ASSERT( m_N_walkers >= 2*centre.size() ); // fewer and the ensemble can't span the parameter space
+   m_walkers.assign(m_N_walkers, centre);
+   m_log_posterior.assign(m_N_walkers, 0.0);
+   #pragma omp parallel for
+   for (size_t k = 0; k < m_N_walkers; k++) {
+      CounterRNG rng = random_stream(m_seed, MCMC_INITIAL_WALKERS, k);
+      for (size_t j = 0; j < centre.size(); j++) m_walkers[k][j] += spread[j] * rng.uniform(-1.0, 1.0);
+      m_log_posterior[k] = log_posterior(m_walkers[k]);
+   }
+   m_step = 0;
+   m_N_accepted = 0;
+   m_N_proposed = 0;
+}
+
+void EnsembleSampler::run(const size_t N_steps, const std::string& chain_filename, const size_t thin) {
+   ASSERT( !m_walkers.empty() ); // initialise() first
+   ASSERT( thin >= 1 );
+   const size_t N_params = m_walkers[0].size();
+   const size_t half = m_N_walkers / 2;
+
+   FILE* chain = nullptr;
+   if (!chain_filename.empty()) {
+      const bool append = (chain_filename == m_open_filename);
+      chain = fopen(chain_filename.c_str(), append ? "ab" : "wb");
+      ASSERT( chain != nullptr );
+      if (!append) {
+         ChainHeader header;
+         memcpy(header.magic, chain_magic, sizeof(chain_magic));
+         header.N_params  = N_params;
+         header.N_walkers = m_N_walkers;
+         ASSERT( fwrite(&header, sizeof(header), 1, chain) == 1 );
+      }
+      m_open_filename = chain_filename;
+   }
+   std::vector<double> record(m_N_walkers * (N_params+1));
+
+   for (size_t step = 0; step < N_steps; step++, m_step++) {
+      size_t accepted = 0;
+      for (size_t side = 0; side < 2; side++) {
+         // walkers [first, first+half) move, using the other half (which stays put meanwhile) as the ensemble
+         const size_t first = side*half, other = (1-side)*half;
+         #pragma omp parallel for reduction(+:accepted)
+         for (size_t k = first; k < first + half; k++) {
+            CounterRNG rng = random_stream(m_seed, MCMC_STRETCH_MOVES, m_step*m_N_walkers + k);
+            const Params& partner = m_walkers[other + rng.below(half)];
+            const double u = rng.uniform();
+            const double z = ((m_stretch - 1.0)*u + 1.0) * ((m_stretch - 1.0)*u + 1.0) / m_stretch; // p(z) ~ 1/sqrt(z)
+            Params proposal(N_params);
+            for (size_t j = 0; j < N_params; j++) proposal[j] = partner[j] + z*(m_walkers[k][j] - partner[j]);
+            const double proposal_log_posterior = log_posterior(proposal);
+            const double log_ratio = (N_params - 1.0)*log(z) + proposal_log_posterior - m_log_posterior[k];
+            if (log(rng.uniform()) < log_ratio) {
+               m_walkers[k] = proposal;
+               m_log_posterior[k] = proposal_log_posterior;
+               accepted++;
+            }
+         }
+      }
+      m_N_accepted += accepted;
+      m_N_proposed += m_N_walkers;
+
+      if (chain != nullptr && (step+1) % thin == 0) {
+         for (size_t k = 0; k < m_N_walkers; k++) {
+            std::copy(m_walkers[k].begin(), m_walkers[k].end(), record.begin() + k*(N_params+1));
+            record[k*(N_params+1) + N_params] = m_log_posterior[k];
+         }
+         ASSERT( fwrite(record.data(), sizeof(double), record.size(), chain) == record.size() );
+      }
+   }
+   if (chain != nullptr) fclose(chain);
+}
+
+double EnsembleSampler::acceptance_fraction() const {
+   return (m_N_proposed > 0) ? m_N_accepted / (double)m_N_proposed : 0.0;
+}
+
+bool EnsembleSampler::read_chain(const std::string& chain_filename, 
+                      /*output*/ std::vector<double>* samples, 
+                      /*output*/ size_t* N_params, 
+                      /*output*/ size_t* N_walkers) {
+   FILE* chain = fopen(chain_filename.c_str(), "rb");
+   if (chain == nullptr) return false;
+   ChainHeader header;
+   // trust nothing in the header until it's checked: a walker count of 0 would have the size check divide by zero
+   bool valid = fread(&header, sizeof(header), 1, chain) == 1 
+             && memcmp(header.magic, chain_magic, sizeof(chain_magic)) == 0
+             && header.N_walkers >= 4 && header.N_params > 0;
+   if (valid) {
+      samples->clear();
+      double buffer[4096];
+      size_t N_read;
+      while ((N_read = fread(buffer, sizeof(double), 4096, chain)) > 0) {
+         samples->insert(samples->end(), buffer, buffer + N_read);
+      }
+      valid = samples->size() % (header.N_walkers * (header.N_params+1)) == 0;
+   }
+   if (valid) {
+      *N_params  = header.N_params;
+      *N_walkers = header.N_walkers;
+   }
+   fclose(chain);
+   return valid;
+}
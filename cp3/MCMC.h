@@ -0,0 +1,61 @@
+#ifndef MCMC_H
+#define MCMC_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include "../global.h"
+#include "Minimiser.h"
+
+/*
+   Affine invariant ensemble sampler (Goodman & Weare's stretch move, as in emcee) for the posterior of a Minimiser's
+   parameters, taking log(posterior) = -chisq/2 with a flat prior inside optional limits. Each walker proposes a 
+   point along the line through itself and a random walker from the other half of the ensemble, so the proposals 
+   adapt to the shape and scale of the posterior with nothing to tune. Updating one half of the walkers at a time 
+   against the other half keeps detailed balance while every walker in a half is moved in parallel. Each walker 
+   gets a fresh random stream per step from (seed, step, walker), so a given seed gives the same chain for any 
+   number of threads. Chains can be streamed to a binary file as they go, so long runs don't need the memory
+*/
+class EnsembleSampler {
+public:
+   EnsembleSampler(const Minimiser& config, const size_t N_walkers, const uint64_t seed = 1);
+
+   void set_stretch(double a)                            { m_stretch = a; } // proposal scale, 2 is the usual
+   void set_limits(const Params& pmin, const Params& pmax);                 // zero prior outside these
+
+   // walkers scattered uniformly within +-spread of centre, e.g. a fitted minimum and its errors
+   void initialise(const Params& centre, const Params& spread);
+
+   /* N_steps moves of every walker. Every thin'th step the position and log posterior of every walker is appended 
+      to chain_filename, if one is given (an existing file is overwritten by the first run() and added to by the 
+      rest) */
+   void run(const size_t N_steps, const std::string& chain_filename = "", const size_t thin = 1);
+
+   double acceptance_fraction() const;
+   const std::vector<Params>& walkers() const { return m_walkers; }
+   const std::vector<double>& log_posteriors() const { return m_log_posterior; }
+
+   /* Reads a whole chain file back: samples holds N_saved_steps*N_walkers rows of N_params+1 values (the params 
+      then the log posterior), one walker after another within each saved step. Returns false, leaving N_params 
+      and N_walkers alone, for a missing, truncated or corrupt file */
+   static bool read_chain(const std::string& chain_filename, 
+               /*output*/ std::vector<double>* samples, 
+               /*output*/ size_t* N_params, 
+               /*output*/ size_t* N_walkers);
+
+private:
+   double log_posterior(const Params& params) const;
+
+   Minimiser m_minimiser;
+   size_t m_N_walkers;
+   uint64_t m_seed;
+   double m_stretch;
+   Params m_limits_min, m_limits_max;
+   std::vector<Params> m_walkers;
+   std::vector<double> m_log_posterior;
+   size_t m_step;                    // total steps taken, so random streams carry on between runs
+   size_t m_N_accepted, m_N_proposed;
+   std::string m_open_filename;      // chain file written by the last run(), appended to if it's the same one
+};
+
+#endif
@@ -1,14 +1,29 @@
 #include <vector>
 #include <sstream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdarg.h>
+#include <omp.h>
 #include "../matplotlibcpp.h"
 namespace plt = matplotlibcpp; 
 
 #include "../global.h"
 #include "Minimiser.h"
 #include "DataPoints.h"
+#include "Random.h"
+
+// number of grid points each thread evaluates together in n_dimensional_grid_search()
+const size_t GRID_BATCH = 64;
 
 Minimiser::Minimiser(const DataPoints& data) 
-      : function_to_minimise(nullptr), model_function(nullptr), m_datapoints(data) { }
+      : function_to_minimise(nullptr), batch_function_to_minimise(nullptr), model_function(nullptr), 
+        model_gradient(nullptr), m_method(GRID_ITERATION), m_error_method(HESSIAN_ERRORS), 
+        m_global_method(GRID_SEARCH), m_global_population(0), m_global_iterations(1000), m_seed(1), 
+        m_N_threads(0), m_quiet(false), m_progress_interval(0.2), m_last_progress(-1e200), m_observer(nullptr), 
+        m_observer_data(nullptr), m_base_level(0), m_datapoints(data), m_iterations_curr(0), m_value_curr(0.0) { 
+   m_datapoints.update_inverse_errors();
+}
 
 void Minimiser::set_param_limits(const Params& params_min, 
                                  const Params& params_max) {
@@ -25,6 +40,7 @@ void Minimiser::set_param_limits(const Params& params_min,
 void Minimiser::set_function_to_minimise_implementation(FunctionToMinimise f, 
                                                         const std::string& function_name) { 
    function_to_minimise = f; 
+   batch_function_to_minimise = nullptr; // only set_model() knows of a batch version to go with it
    m_function_name = function_name;
 }
 
@@ -53,28 +69,358 @@ void Minimiser::minimise() {
    ASSERT( model_function       != nullptr);              // model function (linear) has been assigned
 
    const size_t N_params = m_params_min.size();
-   printf("Function       = %s\n", m_model_func_name.c_str());
-   printf("N_volumes      = %zu\n", m_N_grid_volumes);
-   printf("N_params       = %zu\n", N_params);
-   printf("Max iterations = %zu\n", m_iterations_max);
-   printf("\t%s\n\n", m_model_description.c_str());
+   print("Function       = %s\n", m_model_func_name.c_str());
+   print("N_volumes      = %zu\n", m_N_grid_volumes);
+   print("N_params       = %zu\n", N_params);
+   print("Max iterations = %zu\n", m_iterations_max);
+   print("Method         = %s\n", (m_method == LEVENBERG_MARQUARDT) ? "levenberg-marquardt" :
+                                    (m_method == BFGS)                ? "bfgs" : "grid iteration");
+   const char* global_name = (m_global_method == MULTI_START)            ? "multi-start" :
+                             (m_global_method == DIFFERENTIAL_EVOLUTION) ? "differential evolution" :
+                             (m_global_method == SIMULATED_ANNEALING)    ? "simulated annealing" : "grid search";
+   print("Global method  = %s\n", global_name);
+   print("\t%s\n\n", m_model_description.c_str());
    
-   Params grid_search_params(N_params, 0.0); // parameters to be passed and changed through recursion
    Params min_parameters(N_params, 0.0); // values of each parameter that minimises the function
    double min_value = 1e200;
+   m_iterations_curr = 0;
+   m_telemetry = FitTelemetry();
+   m_base_level = omp_get_level();
 
-   // recursively find a good spot to start by trying parm values within params_min->params_max
-   printf("Starting initial grid search...\n");
-   n_dimensional_grid_search(grid_search_params, m_params_max, m_params_min, m_N_grid_volumes, N_params, 
-                             &min_value, &min_parameters);
-   printf("\nFinished initial grid search!\nInitial grid-searched parameters:\n");
+   // find a good spot to start by trying parm values within params_min->params_max
+   print("Starting initial %s...\n", global_name);
+   double phase_start = omp_get_wtime();
+   switch (m_global_method) {
+      case MULTI_START: 
+         multi_start(m_params_max, m_params_min, &min_value, &min_parameters, &m_iterations_curr); 
+         break;
+      case DIFFERENTIAL_EVOLUTION: 
+         differential_evolution(m_params_max, m_params_min, &min_value, &min_parameters);
+         break;
+      case SIMULATED_ANNEALING: 
+         simulated_annealing(m_params_max, m_params_min, &min_value, &min_parameters);
+         break;
+      default: 
+         n_dimensional_grid_search(m_params_max, m_params_min, m_N_grid_volumes, &min_value, &min_parameters);
+         break;
+   }
+   m_telemetry.global_search_time = omp_get_wtime() - phase_start;
+   report(GLOBAL_SEARCH, 0, min_value, min_parameters);
+   print("\nFinished initial %s!\nInitial parameters:\n", global_name);
    for (size_t i = 0; i < min_parameters.size(); i++) {
       double p = min_parameters[i];
-      printf("\t%c = %s%f\n", (char)('a'+i), (p<0?"":" "), p);
+      print("\t%c = %s%f\n", (char)('a'+i), (p<0?"":" "), p);
    }
-   printf("\n");
+   print("\n");
 
    m_params_curr = min_parameters; // set the initial starting parameters based on this search
+   double current_chisq = min_value;
+
+   if (m_global_method != MULTI_START) { // which has already done the local minimisation from every start
+      print("Starting iteration...\n");
+      phase_start = omp_get_wtime();
+      current_chisq = local_minimisation(&m_params_curr, &m_iterations_curr);
+      m_telemetry.local_minimisation_time = omp_get_wtime() - phase_start;
+   }
+   print("\nFinished iteration!\n");
+   print("Iteration count = %zu\n", m_iterations_curr);
+   print("Epsilon         = %.0e\n", m_epsilon);
+   print("Minimum %s = %f\n", m_function_name.c_str(), current_chisq);
+   m_value_curr = current_chisq;
+}
+
+// printf, unless set_quiet(true) was called
+void Minimiser::print(const char* format, ...) const {
+   if (m_quiet) return;
+   va_list args;
+   va_start(args, format);
+   vprintf(format, args);
+   va_end(args);
+}
+
+/* Prints progress through the current phase as a percentage, at most once every m_progress_interval seconds so 
+   the printing never costs more than the work. Only call it from outside parallel regions or from one thread */
+void Minimiser::progress(const double fraction) const {
+   if (m_quiet || m_progress_interval < 0.0) return;
+   const double now = omp_get_wtime();
+   if (now - m_last_progress < m_progress_interval) return;
+   m_last_progress = now;
+   printf("%6.2f%% \r", 100.0*fraction);
+   fflush(stdout);
+}
+
+// every objective evaluation goes through here so the telemetry can count them
+double Minimiser::evaluate(const Params& params) const {
+   count_evaluations(1);
+   return function_to_minimise(m_datapoints, params, model_function);
+}
+
+void Minimiser::count_evaluations(const size_t N) const {
+   #pragma omp atomic
+   m_telemetry.evaluations += N;
+}
+
+/* Called once per step of the serial parts of a fit: adds the value to the convergence trace and hands everything 
+   to the observer, if there is one. Steps taken inside the fit's own parallel regions (multi-start, annealing 
+   chains) aren't reported since there's no single sequence of them to speak of */
+void Minimiser::report(const FitPhase phase, 
+                       const size_t iteration, 
+                       const double value, 
+                       const Params& params) const {
+   if (in_parallel_part()) return;
+   if (phase == LOCAL_MINIMISATION) m_telemetry.trace.push_back(value);
+   if (m_observer != nullptr) m_observer(phase, iteration, value, params, m_observer_data);
+}
+
+/* Whether we're inside one of this fit's own parallel regions, as opposed to the whole fit being run from inside 
+   one (like fit_many() does), which would count as serial */
+bool Minimiser::in_parallel_part() const {
+   return omp_get_level() > m_base_level;
+}
+
+// team size for each of the fit's parallel loops, set_threads(1) keeps a whole fit on the calling thread
+int Minimiser::threads() const {
+   return (m_N_threads > 0) ? m_N_threads : omp_get_max_threads();
+}
+
+void Minimiser::set_datapoints(const DataPoints& data) {
+   m_datapoints = data;
+   m_datapoints.update_inverse_errors();
+   m_unweighted_e.clear();
+}
+
+void Minimiser::add_datapoints(const DataPoints& data) {
+   if (!m_unweighted_e.empty()) m_unweighted_e.insert(m_unweighted_e.end(), data.e.begin(), data.e.end());
+   m_datapoints.append(data);
+}
+
+/* Weight w_i on point i's contribution to chisq, done by setting its error to e_i/sqrt(w_i) so every function to 
+   minimise picks it up, whether it uses e or the cached 1/e. A weight of zero drops the point (e = inf, 1/e = 0).
+   The original errors are kept the first time, so weights always apply to those rather than stacking up */
+void Minimiser::set_point_weights(const std::vector<double>& weights) {
+   ASSERT( weights.size() == m_datapoints.e.size() );
+   if (m_unweighted_e.empty()) m_unweighted_e = m_datapoints.e;
+   for (size_t i = 0; i < weights.size(); i++) {
+      ASSERT( weights[i] >= 0.0 );
+      const double root_w = sqrt(weights[i]);
+      m_datapoints.inv_e[i] = root_w / m_unweighted_e[i];
+      m_datapoints.e[i]     = (root_w > 0.0) ? m_unweighted_e[i] / root_w : INFINITY;
+   }
+}
+
+/* Skips the global search and runs the local minimisation straight from start, for when we already know roughly 
+   where the minimum is: a refit after the data or weights have changed a little, say */
+void Minimiser::minimise_from(const Params& start) {
+   ASSERT( start.size() != 0 );
+   ASSERT( function_to_minimise != nullptr );
+   ASSERT( model_function       != nullptr );
+   m_telemetry = FitTelemetry();
+   m_base_level = omp_get_level();
+   m_iterations_curr = 0;
+   m_params_curr = start;
+   const double phase_start = omp_get_wtime();
+   m_value_curr = local_minimisation(&m_params_curr, &m_iterations_curr);
+   m_telemetry.local_minimisation_time = omp_get_wtime() - phase_start;
+}
+
+double Minimiser::local_minimisation(/*in/out*/ Params* params, 
+                                     /*in/out*/ size_t* iterations) const {
+   switch (m_method) {
+      case LEVENBERG_MARQUARDT: return levenberg_marquardt(params, iterations);
+      case BFGS:                return bfgs(params, iterations);
+      default:                  return grid_iteration(params, iterations);
+   }
+}
+
+/* N_points spread over the box between pmin and pmax so that, along every parameter axis, exactly one point lands 
+   in each of the N_points equal slices. Much better coverage than N_points uniform randoms for the same cost */
+std::vector<Params> Minimiser::latin_hypercube(const Params& pmax, 
+                                               const Params& pmin, 
+                                               const size_t N_points) const {
+   const size_t N_params = pmin.size();
+   std::vector<Params> points(N_points, Params(N_params));
+   std::vector<size_t> slice(N_points);
+   for (size_t j = 0; j < N_params; j++) {
+      CounterRNG rng = random_stream(m_seed, LATIN_HYPERCUBE_RANDOMS, j);
+      // shuffle which slice each point takes along this axis
+      for (size_t k = 0; k < N_points; k++) slice[k] = k;
+      for (size_t k = N_points; k > 1; k--) std::swap(slice[k-1], slice[rng.below(k)]);
+      const double lo = MIN(pmin[j], pmax[j]), width = fabs(pmax[j] - pmin[j]);
+      for (size_t k = 0; k < N_points; k++) {
+         points[k][j] = lo + width * (slice[k] + rng.uniform()) / (double)N_points;
+      }
+   }
+   return points;
+}
+
+/* Runs the local minimisation (m_method) from every point of a latin hypercube over the parameter limits, spread 
+   across threads, and keeps the best. Each local run is independent and picks the lowest-index start on a tie, so 
+   the result doesn't depend on the thread count */
+void Minimiser::multi_start(const Params& pmax,
+                            const Params& pmin,
+                 /*output*/ double* min_value,
+                 /*output*/ Params* params_at_min,
+                 /*output*/ size_t* iterations) const {
+   const size_t N_starts = (m_global_population > 0) ? m_global_population : MAX( 4*pmin.size(), (size_t)16 );
+   std::vector<Params> params = latin_hypercube(pmax, pmin, N_starts);
+   std::vector<double> values(N_starts);
+   std::vector<size_t> start_iterations(N_starts, 0);
+
+   #pragma omp parallel for num_threads(threads()) schedule(dynamic)
+   for (size_t k = 0; k < N_starts; k++) {
+      values[k] = local_minimisation(&params[k], &start_iterations[k]);
+   }
+
+   for (size_t k = 0; k < N_starts; k++) {
+      if (values[k] < *min_value) {
+         *min_value     = values[k];
+         *params_at_min = params[k];
+         *iterations    = start_iterations[k];
+      }
+   }
+}
+
+/* Differential evolution (DE/rand/1/bin): every generation, each member of the population gets a trial made from 
+   three other random members a + F*(b - c), crossed over parameter by parameter with the member itself, and the 
+   trial replaces the member if it's no worse. Trials for a whole generation are evaluated in parallel. Each member
+   has its own random stream, so a given seed gives the same answer on any number of threads. Stops after 
+   m_global_iterations generations, or once the whole population is within epsilon of the best */
+void Minimiser::differential_evolution(const Params& pmax,
+                                       const Params& pmin,
+                            /*output*/ double* min_value,
+                            /*output*/ Params* params_at_min) const {
+   const size_t N_params  = pmin.size();
+   const size_t N_members = (m_global_population > 0) ? MAX( m_global_population, (size_t)4 ) 
+                                                      : MAX( 10*N_params, (size_t)20 );
+   const double F  = 0.8; // how far along the difference vector to go
+   const double CR = 0.9; // probability of taking each param from the mutant rather than the member
+
+   std::vector<Params> members = latin_hypercube(pmax, pmin, N_members);
+   std::vector<Params> trials  = members;
+   std::vector<double> values(N_members), trial_values(N_members);
+   #pragma omp parallel for num_threads(threads())
+   for (size_t k = 0; k < N_members; k++) {
+      values[k] = evaluate(members[k]);
+   }
+
+   for (size_t generation = 0; generation < m_global_iterations; generation++) {
+      #pragma omp parallel for num_threads(threads())
+      for (size_t k = 0; k < N_members; k++) {
+         CounterRNG rng = random_stream(m_seed, DIFFERENTIAL_EVOLUTION_RANDOMS, generation*N_members + k);
+         size_t a, b, c;
+         do { a = rng.below(N_members); } while (a == k);
+         do { b = rng.below(N_members); } while (b == k || b == a);
+         do { c = rng.below(N_members); } while (c == k || c == a || c == b);
+         const size_t forced = rng.below(N_params); // always take at least one param from the mutant
+         for (size_t j = 0; j < N_params; j++) {
+            double p = members[k][j];
+            if (j == forced || rng.uniform() < CR) {
+               p = members[a][j] + F*(members[b][j] - members[c][j]);
+               // anything that leaves the limits is put back somewhere between the member and the limit it crossed
+               const double lo = MIN(pmin[j], pmax[j]), hi = MAX(pmin[j], pmax[j]);
+               if (p < lo) p = rng.uniform(lo, members[k][j]);
+               if (p > hi) p = rng.uniform(members[k][j], hi);
+            }
+            trials[k][j] = p;
+         }
+         trial_values[k] = evaluate(trials[k]);
+      }
+
+      double worst = -1e200;
+      size_t best = 0;
+      for (size_t k = 0; k < N_members; k++) {
+         if (trial_values[k] <= values[k]) {
+            members[k] = trials[k];
+            values[k]  = trial_values[k];
+         }
+         if (values[k] < values[best]) best = k;
+         worst = MAX(worst, values[k]);
+      }
+      report(GLOBAL_SEARCH, generation, values[best], members[best]);
+      progress((generation+1) / (double)m_global_iterations);
+      if (worst - values[best] < m_epsilon) break;
+   }
+
+   for (size_t k = 0; k < N_members; k++) {
+      if (values[k] < *min_value) {
+         *min_value     = values[k];
+         *params_at_min = members[k];
+      }
+   }
+}
+
+/* Simulated annealing: independent chains start from a latin hypercube, each taking random steps and accepting 
+   uphill ones with probability exp(-rise/T). T falls geometrically over m_global_iterations steps from the spread 
+   of the starting values down to epsilon. Each chain has N_params*10 moves at every temperature, with the step 
+   size adjusted between temperatures to keep roughly 40% of moves accepted. Chains run in parallel with their own 
+   random streams, and the best point any chain visits is kept */
+void Minimiser::simulated_annealing(const Params& pmax,
+                                    const Params& pmin,
+                         /*output*/ double* min_value,
+                         /*output*/ Params* params_at_min) const {
+   const size_t N_params = pmin.size();
+   const size_t N_chains = (m_global_population > 0) ? m_global_population : 16;
+   const size_t N_moves  = 10*N_params;
+   std::vector<Params> start = latin_hypercube(pmax, pmin, N_chains);
+   std::vector<double> start_values(N_chains);
+   #pragma omp parallel for num_threads(threads())
+   for (size_t k = 0; k < N_chains; k++) {
+      start_values[k] = evaluate(start[k]);
+   }
+
+   // starting temperature from the spread of function values over the whole box
+   double mean = 0.0, variance = 0.0;
+   for (const double v : start_values) mean += v / N_chains;
+   for (const double v : start_values) variance += (v-mean)*(v-mean) / N_chains;
+   const double T_start = MAX( sqrt(variance), 1.0 );
+   const double T_end   = MAX( m_epsilon, 1e-12*T_start );
+   const double cooling = pow(T_end / T_start, 1.0 / (double)MAX( m_global_iterations, (size_t)1 ));
+
+   std::vector<Params> best_params = start;
+   std::vector<double> best_values = start_values;
+   #pragma omp parallel for num_threads(threads()) schedule(dynamic)
+   for (size_t k = 0; k < N_chains; k++) {
+      CounterRNG rng = random_stream(m_seed, SIMULATED_ANNEALING_RANDOMS, k);
+      Params current = start[k], trial(N_params), step(N_params);
+      double value = start_values[k];
+      for (size_t j = 0; j < N_params; j++) step[j] = 0.1 * fabs(pmax[j] - pmin[j]);
+
+      double T = T_start;
+      for (size_t iteration = 0; iteration < m_global_iterations; iteration++, T *= cooling) {
+         size_t accepted = 0;
+         for (size_t move = 0; move < N_moves; move++) {
+            trial = current;
+            const size_t j = move % N_params;
+            trial[j] += step[j] * rng.uniform(-1.0, 1.0);
+            const double trial_value = evaluate(trial);
+            if (trial_value <= value || rng.uniform() < exp((value - trial_value) / T)) {
+               current = trial;
+               value   = trial_value;
+               accepted++;
+               if (value < best_values[k]) {
+                  best_values[k] = value;
+                  best_params[k] = current;
+               }
+            }
+         }
+         const double scale = (accepted > 0.4*N_moves) ? 1.2 : 0.8;
+         for (size_t j = 0; j < N_params; j++) step[j] *= scale;
+      }
+   }
+
+   for (size_t k = 0; k < N_chains; k++) {
+      if (best_values[k] < *min_value) {
+         *min_value     = best_values[k];
+         *params_at_min = best_params[k];
+      }
+   }
+}
+
+/* The original method: try every combination of p+-dp around the current parameters, moving to the best one, and 
+   halve all the steps whenever the function goes up. Needs 2^N_params evaluations per iteration */
+double Minimiser::grid_iteration(/*in/out*/ Params* params, 
+                                 /*in/out*/ size_t* iterations) const {
+   const size_t N_params = params->size();
    Params d_params(N_params, 0.0);
    for (size_t i = 0; i < N_params; i++) {
       // search range for each param set to half of that from n_dimensional_grid_search()
@@ -83,65 +429,329 @@ void Minimiser::minimise() {
 
    double difference    = 1e200;
    double current_chisq = 1e200;
-
-   printf("Starting iteration...\n");
-   while (m_iterations_curr < m_iterations_max && difference > m_epsilon) {
+   while ((*iterations) < m_iterations_max && difference > m_epsilon) {
       double previous_chisq = current_chisq;
       current_chisq = 1e200;
 
-      // uses m_params_curr as the starting point for recursion, updates the pointer's values as it finds new minima
-      n_dimensional_minimisation(m_params_curr, N_params, d_params, &current_chisq, &m_params_curr);
+      // uses params as the starting point for recursion, updates the pointer's values as it finds new minima
+      n_dimensional_minimisation(*params, N_params, d_params, &current_chisq, params);
 
       // update variables for rechecking, then loop around for next iteration
       difference = abs(previous_chisq - current_chisq);
-      m_iterations_curr++;
+      (*iterations)++;
       // if this chisq value is higher than the last, halve increments in all directions
       if (current_chisq > previous_chisq) {
          for (auto& dp : d_params) {
             dp /= 2.0;
          }
       }
-      // print current progress percentage
-      printf("%6.2f%% \r", 100*(double)m_iterations_curr/(double)m_iterations_max);
+      report(LOCAL_MINIMISATION, *iterations, current_chisq, *params);
+      // print current progress percentage, unless this is one of many running at once
+      if (!in_parallel_part()) progress((double)(*iterations)/(double)m_iterations_max);
+   }
+   return current_chisq;
+}
+
+/* dy/dp of the model at x. Uses the analytic gradient if one was given, otherwise forward differences from y, the
+   model value at params that the caller already has. scratch is a copy of params that gets nudged one element at a
+   time, passed in so we don't allocate once per data point */
+void Minimiser::model_derivatives(const double x, 
+                                  const Params& params, 
+                                  const double y,
+                                  Params* scratch,
+                       /*output*/ Params* gradient) const {
+   if (model_gradient != nullptr) {
+      model_gradient(x, params, gradient);
+      return;
+   }
+   for (size_t j = 0; j < params.size(); j++) {
+      const double h = 1.5e-8 * MAX( fabs(params[j]), 1.0 ); // ~sqrt(machine epsilon), scaled to the param
+      (*scratch)[j] = params[j] + h;
+      (*gradient)[j] = (model_function(x, *scratch) - y) / h;
+      (*scratch)[j] = params[j];
+   }
+}
+
+// chi squared straight from the model residuals, for the methods that need the residuals themselves
+double Minimiser::residual_chisq(const Params& params) const {
+   count_evaluations(1);
+   double chisq = 0.0;
+   for (size_t i = 0; i < m_datapoints.x.size(); i++) {
+      const double r = (m_datapoints.y[i] - model_function(m_datapoints.x[i], params)) * m_datapoints.inv_e[i];
+      chisq += r*r;
+   }
+   return chisq;
+}
+
+/* With residuals r_i = (y_i - f(x_i))/e_i and jacobian J_ij = dr_i/dp_j = -(df/dp_j)/e_i, builds A = J^T*J and 
+   g = J^T*r one data point at a time, so J itself never has to be stored. Returns chisq = r^T*r */
+double Minimiser::normal_equations(const Params& params, 
+                        /*output*/ SquareMatrix* A, 
+                        /*output*/ Params* g) const {
+   count_evaluations(1);
+   #pragma omp atomic
+   m_telemetry.gradient_evaluations++;
+   const size_t N_params = params.size();
+   *A = SquareMatrix(N_params, 0.0);
+   g->assign(N_params, 0.0);
+   Params scratch = params, gradient(N_params, 0.0);
+   double chisq = 0.0;
+   for (size_t i = 0; i < m_datapoints.x.size(); i++) {
+      const double x   = m_datapoints.x[i];
+      const double y   = model_function(x, params);
+      const double inv = m_datapoints.inv_e[i];
+      const double r   = (m_datapoints.y[i] - y) * inv;
+      model_derivatives(x, params, y, &scratch, &gradient);
+      for (size_t j = 0; j < N_params; j++) {
+         const double Jj = -gradient[j] * inv;
+         (*g)[j] += Jj * r;
+         for (size_t k = 0; k <= j; k++) {
+            (*A)(j, k) += Jj * (-gradient[k] * inv);
+         }
+      }
+      chisq += r*r;
+   }
+   for (size_t j = 0; j < N_params; j++) {
+      for (size_t k = 0; k < j; k++) (*A)(k, j) = (*A)(j, k);
+   }
+   return chisq;
+}
+
+/* Levenberg-Marquardt: solve (A + lambda*diag(A))*delta = -g for the step. Small lambda gives a gauss-newton step, 
+   large lambda a short steepest descent step. lambda shrinks after every step that lowers chisq and grows after 
+   every one that doesn't. Stops once an accepted step improves chisq by less than epsilon */
+double Minimiser::levenberg_marquardt(/*in/out*/ Params* params, 
+                                      /*in/out*/ size_t* iterations) const {
+   const size_t N_params = params->size();
+   SquareMatrix A, damped;
+   Params g, delta, trial(N_params);
+   double lambda = 1e-3;
+   double chisq  = normal_equations(*params, &A, &g);
+
+   while ((*iterations) < m_iterations_max) {
+      (*iterations)++;
+      damped = A;
+      for (size_t j = 0; j < N_params; j++) {
+         damped(j, j) += lambda * (A(j, j) > 0.0 ? A(j, j) : 1.0);
+      }
+      Params minus_g(N_params);
+      for (size_t j = 0; j < N_params; j++) minus_g[j] = -g[j];
+
+      double trial_chisq = 1e200;
+      if (damped.solve(minus_g, &delta)) {
+         for (size_t j = 0; j < N_params; j++) trial[j] = (*params)[j] + delta[j];
+         trial_chisq = residual_chisq(trial);
+      }
+
+      if (trial_chisq < chisq) {
+         const double improvement = chisq - trial_chisq;
+         *params = trial;
+         lambda = MAX( lambda/10.0, 1e-12 );
+         report(LOCAL_MINIMISATION, *iterations, trial_chisq, *params);
+         if (improvement < m_epsilon) {
+            chisq = trial_chisq;
+            break;
+         }
+         chisq = normal_equations(*params, &A, &g);
+      } else {
+         lambda *= 10.0;
+         if (lambda > 1e16) break; // can't go downhill any more, so we're at the minimum
+      }
+   }
+   return evaluate(*params);
+}
+
+// central differences of function_to_minimise, for when we don't know anything about its structure
+void Minimiser::objective_gradient(const Params& params, 
+                        /*output*/ Params* gradient) const {
+   #pragma omp atomic
+   m_telemetry.gradient_evaluations++;
+   Params scratch = params;
+   gradient->assign(params.size(), 0.0);
+   for (size_t j = 0; j < params.size(); j++) {
+      const double h = 6e-6 * MAX( fabs(params[j]), 1.0 ); // ~cbrt(machine epsilon), scaled to the param
+      scratch[j] = params[j] + h;
+      const double above = evaluate(scratch);
+      scratch[j] = params[j] - h;
+      const double below = evaluate(scratch);
+      scratch[j] = params[j];
+      (*gradient)[j] = (above - below) / (2.0*h);
+   }
+}
+
+/* BFGS: keeps an estimate H of the inverse hessian, steps along -H*g with a backtracking line search, then updates
+   H from the change in position s and change in gradient y. Stops once a step improves the function by less 
+   than epsilon */
+double Minimiser::bfgs(/*in/out*/ Params* params, 
+                       /*in/out*/ size_t* iterations) const {
+   const size_t N_params = params->size();
+   SquareMatrix H = SquareMatrix::identity(N_params);
+   Params g, g_new, direction(N_params), trial(N_params), s(N_params), y(N_params);
+   double value = evaluate(*params);
+   objective_gradient(*params, &g);
+   bool first_step = true;
+
+   while ((*iterations) < m_iterations_max) {
+      (*iterations)++;
+      direction = H * g;
+      double slope = 0.0;
+      for (size_t j = 0; j < N_params; j++) {
+         direction[j] = -direction[j];
+         slope += g[j] * direction[j];
+      }
+      if (slope >= 0.0) {
+         // H has stopped being positive definite, so fall back to steepest descent
+         H = SquareMatrix::identity(N_params);
+         slope = 0.0;
+         for (size_t j = 0; j < N_params; j++) {
+            direction[j] = -g[j];
+            slope -= g[j] * g[j];
+         }
+         if (slope == 0.0) break; // flat gradient, nowhere to go
+      }
+
+      // backtrack until the armijo condition is met
+      double alpha = 1.0, trial_value = 1e200;
+      while (alpha > 1e-16) {
+         for (size_t j = 0; j < N_params; j++) trial[j] = (*params)[j] + alpha*direction[j];
+         trial_value = evaluate(trial);
+         if (trial_value <= value + 1e-4*alpha*slope) break;
+         alpha *= 0.5;
+      }
+      if (!(trial_value < value)) break; // no downhill step left
+
+      objective_gradient(trial, &g_new);
+      double sy = 0.0, yy = 0.0;
+      for (size_t j = 0; j < N_params; j++) {
+         s[j] = trial[j] - (*params)[j];
+         y[j] = g_new[j] - g[j];
+         sy += s[j]*y[j];
+         yy += y[j]*y[j];
+      }
+      const double improvement = value - trial_value;
+      *params = trial;
+      value = trial_value;
+      g = g_new;
+      report(LOCAL_MINIMISATION, *iterations, value, *params);
+      if (improvement < m_epsilon) break;
+
+      if (sy > 1e-300) {
+         if (first_step) {
+            // rescale the starting guess for H to the curvature we've just seen
+            H = SquareMatrix::identity(N_params);
+            for (size_t j = 0; j < N_params; j++) H(j, j) = sy / yy;
+            first_step = false;
+         }
+         // H = (I - rho*s*y^T) * H * (I - rho*y*s^T) + rho*s*s^T
+         const double rho = 1.0 / sy;
+         const Params Hy = H * y;
+         double yHy = 0.0;
+         for (size_t j = 0; j < N_params; j++) yHy += y[j]*Hy[j];
+         for (size_t j = 0; j < N_params; j++) {
+            for (size_t k = 0; k < N_params; k++) {
+               H(j, k) += -rho*(Hy[j]*s[k] + s[j]*Hy[k]) + (rho*rho*yHy + rho)*s[j]*s[k];
+            }
+         }
+      }
    }
-   printf("\nFinished iteration!\n");
-   printf("Iteration count = %zu\n", m_iterations_curr);
-   printf("Epsilon         = %.0e\n", m_epsilon);
-   printf("Minimum %s = %f\n", m_function_name.c_str(), current_chisq);
+   return value;
 }
 
-/* Basically a recursive for-loop with an arbitrary number of nested loops, depending on params.size().
-   Used to find a good guess for initial parameters to use within the ranges pmax to pmin */
-void Minimiser::n_dimensional_grid_search(Params params,          // test parameters
-                                          const Params& pmax,     // limits of each parameter
+/* Evaluates the function at the midpoint of every one of the N_volumes^N_params grid volumes within pmin->pmax, 
+   used to find a good guess for initial parameters. Every grid point has a flat index whose base-N_volumes digits 
+   are the volume indices along each parameter axis (first parameter = most significant digit). Each thread takes 
+   one contiguous run of indices, steps through it like an odometer and keeps its own minimum, then the per-thread 
+   minima are compared in thread order. Ties go to the lowest index, so the result is the same as a serial scan 
+   whatever the thread count. Points are evaluated in batches through batch_function_to_minimise when the model was
+   given by set_model(), so the data is read once per batch instead of once per point */
+void Minimiser::n_dimensional_grid_search(const Params& pmax,     // limits of each parameter
                                           const Params& pmin,
                                           const size_t N_volumes, // number of grid volumes along each param axis
-                                          const size_t level,     // how deep into the recursion we are
                                /*output*/ double* min_value,      // smallest function value from entire search
                                /*output*/ Params* params_at_min) {// param values at that point
-   if (level == 0) {
-      // print out current progress percentage
-      static size_t index = 0;
-      printf("%6.2f%% \r", index*100.0/pow(N_volumes, params.size()) );
-      index++;
+   const size_t N_params = pmin.size();
+   ASSERT( N_volumes >= 1 );
+   size_t N_points = 1;
+   for (size_t i = 0; i < N_params; i++) {
+      ASSERT( N_points <= std::numeric_limits<size_t>::max() / N_volumes ); // grid is too big to index
+      N_points *= N_volumes;
+   }
+   Params d_param(N_params);
+   for (size_t i = 0; i < N_params; i++) {
+      d_param[i] = (pmax[i]-pmin[i])/(double)N_volumes;
+   }
 
-      // if we're at the bottom of the nested loops, calculate the value, compare to min_value, and back off
-      double this_value = function_to_minimise(m_datapoints, params, model_function);
-      if (this_value < *min_value) { 
-         *min_value = this_value;
-         *params_at_min = params;
+   const int N_threads = threads();
+   std::vector<double> thread_min_value(N_threads, *min_value);
+   std::vector<Params> thread_min_params(N_threads, *params_at_min); // each thread only writes its own
+
+   #pragma omp parallel num_threads(N_threads)
+   {
+      const size_t thread = omp_get_thread_num();
+      const size_t count  = omp_get_num_threads();
+      const size_t first  = N_points * thread / count;
+      const size_t last   = N_points * (thread+1) / count;
+
+      // decode the first index of this thread's run into per-axis volume indices
+      std::vector<size_t> digit(N_params);
+      Params params(N_params);
+      size_t remainder = first;
+      for (size_t i = N_params; i-- > 0; ) {
+         digit[i]  = remainder % N_volumes;
+         remainder = remainder / N_volumes;
+         params[i] = pmin[i] + d_param[i]*(digit[i]+0.5); // midpoint of that grid volume
       }
-      return;
-   } else {
-      // otherwise, loop through all values of this parameter, then iterate down to the next parameter
-      size_t param_index = params.size() - level;
-      const double d_param = (pmax[param_index]-pmin[param_index])/(double)N_volumes;
-      for (size_t i = 0; i < N_volumes; i++) {
-         // update the test parameter value to the midpoint of that grid volume
-         params[param_index] = pmin[param_index] + d_param*(i+0.5);
-         // decrement level to update the next parameter in the next iteration
-         n_dimensional_grid_search(params, pmax, pmin, N_volumes, level-1, 
-                                   min_value, params_at_min);
+
+      // grid points are gathered GRID_BATCH at a time so a batch function can run them all over the data in one
+      // pass, then checked against the minimum in index order
+      std::vector<double> batch(GRID_BATCH * N_params);
+      std::vector<double> batch_values(GRID_BATCH);
+      double local_min = thread_min_value[thread];
+      for (size_t index = first; index < last; ) {
+         // print out progress, judged by the first thread's share
+         if (thread == 0) progress((index-first)/(double)(last-first));
+
+         const size_t N_batch = MIN( GRID_BATCH, last-index );
+         for (size_t k = 0; k < N_batch; k++) {
+            std::copy(params.begin(), params.end(), batch.begin() + k*N_params);
+            // step to the next grid point, carrying into the more significant axes
+            for (size_t i = N_params; i-- > 0; ) {
+               if (++digit[i] < N_volumes) {
+                  params[i] = pmin[i] + d_param[i]*(digit[i]+0.5);
+                  break;
+               }
+               digit[i]  = 0;
+               params[i] = pmin[i] + d_param[i]*0.5;
+            }
+         }
+
+         if (batch_function_to_minimise != nullptr) {
+            batch_function_to_minimise(m_datapoints, batch.data(), N_batch, batch_values.data());
+            count_evaluations(N_batch);
+         } else {
+            Params point(N_params);
+            for (size_t k = 0; k < N_batch; k++) {
+               std::copy(batch.begin() + k*N_params, batch.begin() + (k+1)*N_params, point.begin());
+               batch_values[k] = evaluate(point);
+            }
+         }
+
+         for (size_t k = 0; k < N_batch; k++) {
+            if (batch_values[k] < local_min) {
+               local_min = batch_values[k];
+               thread_min_params[thread].assign(batch.begin() + k*N_params, batch.begin() + (k+1)*N_params);
+            }
+         }
+         index += N_batch;
+      }
+      thread_min_value[thread] = local_min;
+   }
+
+   // every thread started from *min_value, so only one that found something lower can beat it
+   for (int t = 0; t < N_threads; t++) {
+      if (thread_min_value[t] < *min_value) {
+         *min_value     = thread_min_value[t];
+         *params_at_min = thread_min_params[t];
       }
    }
 }
@@ -152,10 +762,10 @@ void Minimiser::n_dimensional_minimisation(Params params,
                                            const int level,        // how deep into the recursion we are
                                            const Params& d_params, // step size along each parameter axis
                                 /*output*/ double* min_value,      // smallest function value from entire search
-                                /*output*/ Params* params_at_min) {// param values at that point
+                                /*output*/ Params* params_at_min) const {// param values at that point
    if (level == 0) {
       // if we're at the bottom of the nested loops, calculate the value, compare to min_value, and back off
-      double this_value = function_to_minimise(m_datapoints, params, model_function);
+      double this_value = evaluate(params);
       if (this_value < *min_value) { 
          *min_value = this_value;
          *params_at_min = params;
@@ -209,89 +819,229 @@ void Minimiser::plot(const std::vector<DataPoints>& data_arr) {
 
 }
 
+// covariance = (H/2)^-1 for chisq, false if H isn't invertible
+static bool covariance_from_hessian(SquareMatrix H, /*output*/ SquareMatrix* cov) {
+   for (size_t i = 0; i < H.size(); i++) {
+      for (size_t j = 0; j < H.size(); j++) {
+         H(i,j) *= 0.5;
+      }
+   }
+   return H.inverse(cov);
+}
+
+/* Works out the error on each fitted parameter using m_error_method, prints them out and keeps them for 
+   get_errors_plus/get_errors_minus/get_covariance. The covariance always comes from the hessian since it's cheap and
+   gives the starting step for the scan. PARAMETER_SCAN then finds the delta(chisq)=1 points along each axis properly
+   and plots chisq against each parameter, the way this used to work */
 void Minimiser::find_parameter_errors(const Params& fitted_params) {
+   const double phase_start = omp_get_wtime();
+   m_base_level = omp_get_level();
    const size_t N_params = fitted_params.size();
-   const size_t N_points = 1e4;
-   const std::string colours = "rcmybg";
+   const double chisq_min = evaluate(fitted_params);
+
+   // one hessian for both the covariance and the scan's first steps, it costs O(N_params^2) chisq evaluations
+   SquareMatrix H;
+   const bool have_hessian = hessian(fitted_params, &H);
+   const bool have_covariance = have_hessian && covariance_from_hessian(H, &m_covariance);
+   if (!have_covariance) {
+      print("Hessian isn't positive definite, is this really a minimum?\n");
+   }
+   m_errors_plus.assign(N_params, NAN);
+   for (size_t i = 0; i < N_params && have_covariance; i++) {
+      m_errors_plus[i] = sqrt(m_covariance(i,i));
+   }
+   m_errors_minus = m_errors_plus;
+
+   if (m_error_method == PARAMETER_SCAN) {
+      // the scan along one axis holds the others fixed, so the first guess is the conditional error 1/sqrt(H_ii/2)
+      Params first_steps(N_params);
+      for (size_t i = 0; i < N_params; i++) {
+         first_steps[i] = (have_hessian && H(i,i) > 0.0) ? sqrt(2.0 / H(i,i)) 
+                                                         : 1e-3 * MAX( fabs(fitted_params[i]), 1.0 );
+      }
+      scan_parameter_errors(fitted_params, first_steps, &m_errors_minus, &m_errors_plus);
+   }
+   m_telemetry.error_time = omp_get_wtime() - phase_start;
+   report(ERROR_ESTIMATION, 0, chisq_min, fitted_params);
+
    for (size_t i = 0; i < N_params; i++) {
-      Params temp_params = fitted_params;
-      const double p     = fitted_params[i];
+      if (m_error_method == PARAMETER_SCAN) {
+         print("\t%c = %s%f + %f - %f\n", (char)('a'+i), (fitted_params[i]<0?"":" "), fitted_params[i], 
+                                             m_errors_plus[i], m_errors_minus[i]);
+      } else {
+         print("\t%c = %s%f +- %f\n", (char)('a'+i), (fitted_params[i]<0?"":" "), fitted_params[i], 
+                                         m_errors_plus[i]);
+      }
+   }
+   if (m_error_method == PARAMETER_SCAN) {
+      // matplotlib isn't thread safe so these happen one after another once the scans are done
+      for (size_t i = 0; i < N_params; i++) {
+         plot_parameter_scan(fitted_params, i, chisq_min);
+      }
+      print("Plots saved in cp3/fig/\n");
+   }
+}
 
-      // spatial resolution in our search along the param axis
-      const double dp = p / (double)N_points;
-      // minimum value of chisq for this parameter
-      const double chisq_min = function_to_minimise(m_datapoints,fitted_params,model_function);
-      
-      double chisq = 0;
-      double max_p;
-      double smallest_distance = 1e200;
-      double p_at_chisq_plus_1, p_at_chisq_minus_1;
-
-      // calculate chisq along the parameter axis and test whether it's more than chisq_min+8
-      for (size_t j = 0; chisq < chisq_min+8; j++) {
-         max_p = p + j*dp;
-         temp_params[i] = max_p;
-         chisq = function_to_minimise(m_datapoints, temp_params, model_function);
-
-         double distance_to_1 = abs(chisq-chisq_min-1);
-         // if this value of the parameter is close to delta(chisq)=1, save the values
-         if (distance_to_1 < smallest_distance) {
-            smallest_distance = distance_to_1;
-            p_at_chisq_plus_1 = max_p;
+/* Second derivatives of function_to_minimise at params by central differences, one step of ~epsilon^(1/4) per param 
+   (scaled to the param but never zero, so p=0 is fine). The N(N+1)/2 independent elements are shared between 
+   threads. Returns false if any came out non-finite */
+bool Minimiser::hessian(const Params& params,
+             /*output*/ SquareMatrix* H) const {
+   const size_t N_params = params.size();
+   const double f0 = evaluate(params);
+   Params h(N_params);
+   for (size_t i = 0; i < N_params; i++) {
+      h[i] = 1e-4 * MAX( fabs(params[i]), 1.0 );
+   }
+   *H = SquareMatrix(N_params, 0.0);
+   const size_t N_elements = N_params * N_params;
+   bool finite = true;
+
+   #pragma omp parallel for num_threads(threads()) schedule(dynamic) reduction(&&:finite)
+   for (size_t element = 0; element < N_elements; element++) {
+      const size_t i = element / N_params;
+      const size_t j = element % N_params;
+      if (j > i) continue; // symmetric, only work out the lower triangle
+      Params p = params;
+      double d2f;
+      if (i == j) {
+         p[i] = params[i] + h[i];
+         const double f_plus  = evaluate(p);
+         p[i] = params[i] - h[i];
+         const double f_minus = evaluate(p);
+         d2f = (f_plus - 2.0*f0 + f_minus) / (h[i]*h[i]);
+      } else {
+         double f[4]; // ++, +-, -+, --
+         for (int k = 0; k < 4; k++) {
+            p[i] = params[i] + ((k < 2)     ? h[i] : -h[i]);
+            p[j] = params[j] + ((k % 2 == 0) ? h[j] : -h[j]);
+            f[k] = evaluate(p);
          }
+         d2f = (f[0] - f[1] - f[2] + f[3]) / (4.0*h[i]*h[j]);
       }
-      // reset values to originals, then do the same but the other side of the minimum value
-      temp_params = fitted_params;
-      chisq = 0;
-      smallest_distance = 1e200;
-      double min_p;
-      for (size_t j = 0; chisq < chisq_min+8; j++) {
-         min_p = p - j*dp;
-         temp_params[i] = min_p;
-         chisq = function_to_minimise(m_datapoints, temp_params, model_function);
-
-         double distance_to_1 = abs(chisq-chisq_min-1);
-         if (distance_to_1 < smallest_distance) {
-            smallest_distance = distance_to_1;
-            p_at_chisq_minus_1 = min_p;
-         }
+      (*H)(i,j) = d2f;
+      (*H)(j,i) = d2f;
+      finite = finite && std::isfinite(d2f);
+   }
+   return finite;
+}
+
+/* Parameter covariance matrix at the minimum. With delta(chisq)=1 defining one sigma, chisq ~ chisq_min + 
+   dp^T*(H/2)*dp near the minimum, so the covariance is (H/2)^-1. The square roots of the diagonal are the errors 
+   with every other parameter allowed to move, i.e. correlations are accounted for */
+bool Minimiser::covariance(const Params& fitted_params,
+                /*output*/ SquareMatrix* cov) const {
+   SquareMatrix H;
+   return hessian(fitted_params, &H) && covariance_from_hessian(H, cov);
+}
+
+/* Distance along the param i axis from fitted_params to where the function equals target, going in the direction 
+   of first_step. Steps out from the minimum doubling each time until the crossing is bracketed, then closes in with 
+   false position (the illinois version, so one end can't get stuck). Returns NAN if it never gets there */
+double Minimiser::crossing(const Params& fitted_params, 
+                           const size_t i, 
+                           const double first_step, 
+                           const double target) const {
+   Params p = fitted_params;
+   auto f = [&](const double t) {
+      p[i] = fitted_params[i] + t;
+      return evaluate(p) - target;
+   };
+
+   double a = 0.0,        fa = f(a);
+   double b = first_step, fb = f(b);
+   for (size_t doublings = 0; fb < 0.0; doublings++) {
+      if (doublings == 60 || !std::isfinite(fb)) return NAN;
+      a = b; fa = fb;
+      b *= 2.0; fb = f(b);
+   }
+
+   const double tolerance = 1e-12 * MAX( fabs(fitted_params[i]), fabs(first_step) );
+   double c = b;
+   for (size_t iteration = 0; iteration < 200; iteration++) {
+      c = b - fb*(b-a)/(fb-fa);
+      const double fc = f(c);
+      if (fabs(fc) < 1e-9 || fabs(b-a) < tolerance) break;
+      if (fc*fb < 0.0) {
+         a = b; fa = fb;
+      } else {
+         fa *= 0.5;
       }
+      b = c; fb = fc;
+   }
+   return fabs(c);
+}
+
+/* For each parameter, finds how far it can move up and down (the rest held at their fitted values) before the 
+   function rises by 1 from its minimum. All 2*N_params root finds run at once across threads, each starting from 
+   first_steps[i] and needing only a few dozen evaluations, rather than walking the axis in tiny fixed steps */
+void Minimiser::scan_parameter_errors(const Params& fitted_params,
+                                      const Params& first_steps,
+                           /*output*/ Params* errors_minus,
+                           /*output*/ Params* errors_plus) const {
+   const size_t N_params = fitted_params.size();
+   const double target = evaluate(fitted_params) + 1.0;
+   errors_minus->assign(N_params, NAN);
+   errors_plus->assign(N_params, NAN);
 
-      // we now have our x limits, so generate points between then
-      double max = MAX(max_p, min_p), min = MIN(max_p, min_p);
-      DataPoints data_points(N_points);
-      data_points.x = generate_smooth_x_values({min,max}, N_points);
+   #pragma omp parallel for num_threads(threads()) schedule(dynamic)
+   for (size_t k = 0; k < 2*N_params; k++) {
+      const size_t i = k / 2;
+      if (k % 2 == 0) {
+         (*errors_plus)[i]  = crossing(fitted_params, i,  first_steps[i], target);
+      } else {
+         (*errors_minus)[i] = crossing(fitted_params, i, -first_steps[i], target);
+      }
+   }
+}
+
+/* Plots the function against parameter i over three times the scanned error either side of the fitted value, with
+   lines marking the minimum and the delta(chisq)=1 points. The curve itself is evaluated in parallel */
+void Minimiser::plot_parameter_scan(const Params& fitted_params, 
+                                    const size_t i, 
+                                    const double chisq_min) const {
+   const size_t N_points = 1e3;
+   const std::string colours = "rcmybg";
+   const double p = fitted_params[i];
+   const double p_at_chisq_plus_1  = p + m_errors_plus[i];
+   const double p_at_chisq_minus_1 = p - m_errors_minus[i];
+   if (!std::isfinite(p_at_chisq_plus_1) || !std::isfinite(p_at_chisq_minus_1)) return;
+   const double max_p = p + 3.0*m_errors_plus[i];
+   const double min_p = p - 3.0*m_errors_minus[i];
+
+   DataPoints data_points(N_points);
+   data_points.x = generate_smooth_x_values({min_p,max_p}, N_points);
+   #pragma omp parallel num_threads(threads())
+   {
+      Params temp_params = fitted_params;
+      #pragma omp for
       for (size_t j = 0; j < N_points; j++) {
          temp_params[i] = data_points.x[j];
-         data_points.y[j] = function_to_minimise(m_datapoints, temp_params, model_function);
+         data_points.y[j] = evaluate(temp_params);
       }
-      data_points.name = (char)('a'+i);
-
-      // now plot them
-      plt::clf();
-      char buf[200];
-      snprintf(buf, sizeof(buf)-1, " = %s%f +- %f", (fitted_params[i]<0?"":" "), 
-                                                     fitted_params[i], 
-                                                     abs(fitted_params[i]-p_at_chisq_plus_1));
-      std::string title = data_points.name + buf;
-      printf("\t%s\n", title.c_str());
-      plt::title(title + "\nwhere " + m_model_description);
-      std::string format = " -";
-      format[0] = colours[i % colours.length()];
+   }
+   data_points.name = (char)('a'+i);
 
-      plt::plot(data_points.x, data_points.y,         format); // chi-sq parabola
-      plt::plot({min_p,max_p}, {chisq_min,chisq_min}, "k-");   // horizontal line indicating minimum of parabola
+   // now plot them
+   plt::clf();
+   char buf[200];
+   snprintf(buf, sizeof(buf)-1, " = %s%f + %f - %f", (p<0?"":" "), p, m_errors_plus[i], m_errors_minus[i]);
+   std::string title = data_points.name + buf;
+   plt::title(title + "\nwhere " + m_model_description);
+   std::string format = " -";
+   format[0] = colours[i % colours.length()];
 
-      plt::plot(XArray(2,p_at_chisq_minus_1),{chisq_min,chisq_min+1},"k-"); // vertical line on the left
-      plt::plot(XArray(2,p_at_chisq_plus_1), {chisq_min,chisq_min+1},"k-"); // vertical line on the right
+   plt::plot(data_points.x, data_points.y,         format); // chi-sq parabola
+   plt::plot({min_p,max_p}, {chisq_min,chisq_min}, "k-");   // horizontal line indicating minimum of parabola
 
-      plt::ylabel(m_function_name);
-      plt::xlabel(data_points.name);
-      // plt::show();
+   plt::plot(XArray(2,p_at_chisq_minus_1),{chisq_min,chisq_min+1},"k-"); // vertical line on the left
+   plt::plot(XArray(2,p_at_chisq_plus_1), {chisq_min,chisq_min+1},"k-"); // vertical line on the right
 
-      std::stringstream ss;
-      ss << "cp3/fig/" << data_points.name << "_parabola.png";
-      plt::save(ss.str());
-   }
-   printf("Plots saved in cp3/fig/\n");
-}
\ No newline at end of file
+   plt::ylabel(m_function_name);
+   plt::xlabel(data_points.name);
+   // plt::show();
+
+   std::stringstream ss;
+   ss << "cp3/fig/" << data_points.name << "_parabola.png";
+   plt::save(ss.str());
+}
@@ -3,55 +3,194 @@
 
 #include <vector>
 #include <stdlib.h>
+#include <stdint.h>
 #include "DataPoints.h"
+#include "SquareMatrix.h"
+#include "ModelFunctions.h"
+#include "ChiSquared.h"
+
+// which local minimisation runs after the initial grid search
+enum MinimisationMethod {
+   GRID_ITERATION,      // step each param by +-dp and halve the steps whenever chisq goes up
+   LEVENBERG_MARQUARDT, // damped gauss-newton, assumes function_to_minimise is chi squared
+   BFGS                 // quasi-newton for any function_to_minimise, using finite difference gradients
+};
+
+// how minimise() finds its starting point before the local minimisation homes in
+enum GlobalMethod {
+   GRID_SEARCH,            // every point of an N_volumes^N_params grid, exponential in N_params
+   MULTI_START,            // local minimisation from a latin hypercube of starting points, best one wins
+   DIFFERENTIAL_EVOLUTION, // population of candidates, each mutated by the difference between two others
+   SIMULATED_ANNEALING     // independent random walks that accept uphill steps less and less as they cool
+};
+
+// how find_parameter_errors() works out the uncertainty on each fitted parameter
+enum ErrorMethod {
+   HESSIAN_ERRORS,      // covariance = 2*H^-1 from the curvature at the minimum, correlations included. Fast
+   PARAMETER_SCAN       // root-find where the function rises by 1 along each param axis, then plot the parabolas
+};
+
+// the parts of a fit, as passed to a FitObserver
+enum FitPhase {
+   GLOBAL_SEARCH,       // finding somewhere to start (grid search, DE, ...)
+   LOCAL_MINIMISATION,  // homing in on the minimum
+   ERROR_ESTIMATION     // find_parameter_errors()
+};
+
+// called after every step of a fit with the phase, step number, function value and params so far
+typedef void (*FitObserver)(const FitPhase phase, const size_t iteration, const double value, 
+                            const Params& params, void* user_data);
+
+// what a fit cost and how it got there, reset by every call to minimise()
+struct FitTelemetry {
+   size_t evaluations;             // of the function being minimised, including each point of a batch
+   size_t gradient_evaluations;    // jacobians/gradients worked out, each also costing a few evaluations
+   double global_search_time;      // wall clock seconds spent in each phase
+   double local_minimisation_time;
+   double error_time;
+   std::vector<double> trace;      // function value after each step of the local minimisation
+
+   FitTelemetry() : evaluations(0), gradient_evaluations(0), global_search_time(0.0), 
+                    local_minimisation_time(0.0), error_time(0.0) { }
+};
 
 class Minimiser {
 public:
    Minimiser(const DataPoints& data);
 
    Params get_final_parameters() const            { return m_params_curr; }
+   double get_final_value() const                 { return m_value_curr; }      // e.g. chisq at the minimum
+   size_t get_iterations() const                  { return m_iterations_curr; } // of the local minimisation
    ModelFunction model()                          { return model_function; }
    std::string model_name() const                 { return m_model_func_name; }
 
    void set_max_iterations(size_t max)            { m_iterations_max = max; m_iterations_curr = 0; }
    void set_epsilon(double e)                     { m_epsilon = e; }
    void set_initial_grid_search_volumes(size_t n) { m_N_grid_volumes = n; } 
+   void set_method(MinimisationMethod method)     { m_method = method; }
+   void set_model_gradient(ModelGradient g)       { model_gradient = g; } // optional, finite differences if not given
+   void set_error_method(ErrorMethod method)      { m_error_method = method; }
+   void set_global_method(GlobalMethod method)    { m_global_method = method; }
+   void set_global_population(size_t n)           { m_global_population = n; } // starts/members/chains, 0 = auto
+   void set_global_iterations(size_t n)           { m_global_iterations = n; } // DE generations or SA cooling steps
+   void set_seed(uint64_t seed)                   { m_seed = seed; }           // same seed = same fit
+   void set_threads(int n)                        { m_N_threads = n; }         // per parallel part, 0 = one per core
+   void set_quiet(bool quiet)                     { m_quiet = quiet; }         // no console output at all
+   void set_progress_interval(double seconds)     { m_progress_interval = seconds; } // between updates, <0 for none
+   void set_observer(FitObserver f, void* data)   { m_observer = f; m_observer_data = data; }
+   const FitTelemetry& telemetry() const          { return m_telemetry; }
+   void set_datapoints(const DataPoints& data);   // fit a different dataset with the same settings
+   void set_point_weights(const std::vector<double>& weights); // scales each point's 1/e^2, e.g. for robust fits
+   void add_datapoints(const DataPoints& data);   // more points on the end of the dataset, weighted 1
+
+   Params get_errors_plus() const                 { return m_errors_plus; }  // filled in by find_parameter_errors()
+   Params get_errors_minus() const                { return m_errors_minus; } // same as plus for HESSIAN_ERRORS
+   SquareMatrix get_covariance() const            { return m_covariance; }   // filled in by either error method
 
    void set_param_limits(const Params&, const Params&);
    void set_function_to_minimise_implementation(FunctionToMinimise f, const std::string& function_name);
    void set_model_function_implementation(ModelFunction f, const std::string& function_name);
 
+   // sets the model, its gradient and chi squared all at once from one of the structs in ModelFunctions.h
+   template<class Model> void set_model() {
+      set_model_function_implementation(model_value<Model>, Model::name());
+      set_model_gradient(::model_gradient<Model>);
+      set_function_to_minimise_implementation(model_chisq<Model>, "chisq");
+      batch_function_to_minimise = model_chisq_many<Model>;
+   }
+
    void minimise();   // does most of the legwork in here
+   void minimise_from(const Params& start); // only the local minimisation, starting from a known good point
+   double function_value(const Params& params) const { return evaluate(params); } // e.g. chisq at params
 
-   void n_dimensional_grid_search(Params params, 
-                                  const Params& pmax,
+   void n_dimensional_grid_search(const Params& pmax,
                                   const Params& pmin,
                                   const size_t N_volumes,
-                                  const size_t level, 
                        /*output*/ double* min_grid_value,
                        /*output*/ Params* params_at_min);
+   void multi_start(const Params& pmax,
+                    const Params& pmin,
+         /*output*/ double* min_value,
+         /*output*/ Params* params_at_min,
+         /*output*/ size_t* iterations) const;
+   void differential_evolution(const Params& pmax,
+                               const Params& pmin,
+                    /*output*/ double* min_value,
+                    /*output*/ Params* params_at_min) const;
+   void simulated_annealing(const Params& pmax,
+                            const Params& pmin,
+                 /*output*/ double* min_value,
+                 /*output*/ Params* params_at_min) const;
+   std::vector<Params> latin_hypercube(const Params& pmax, const Params& pmin, const size_t N_points) const;
+
+   double local_minimisation(/*in/out*/ Params* params, /*in/out*/ size_t* iterations) const; // using m_method
+   double grid_iteration(/*in/out*/ Params* params, /*in/out*/ size_t* iterations) const;
+   double levenberg_marquardt(/*in/out*/ Params* params, /*in/out*/ size_t* iterations) const;
+   double bfgs(/*in/out*/ Params* params, /*in/out*/ size_t* iterations) const;
    void n_dimensional_minimisation(Params params, 
                                    const int level, 
                                    const Params& d_params,
                         /*output*/ double* min_value, 
-                        /*output*/ Params* params_at_min);
+                        /*output*/ Params* params_at_min) const;
    void plot(const std::vector<DataPoints>& points);
    void find_parameter_errors(const Params& fitted_params);
+   bool hessian(const Params& params, /*output*/ SquareMatrix* H) const;
+   bool covariance(const Params& fitted_params, /*output*/ SquareMatrix* cov) const;
+   void scan_parameter_errors(const Params& fitted_params,
+                              const Params& first_steps,
+                   /*output*/ Params* errors_minus,
+                   /*output*/ Params* errors_plus) const;
 
 private:
+   double normal_equations(const Params& params, SquareMatrix* A, Params* g) const;
+   double residual_chisq(const Params& params) const;
+   void model_derivatives(const double x, const Params& params, const double y, 
+                          Params* scratch, Params* gradient) const;
+   void objective_gradient(const Params& params, Params* gradient) const;
+   void print(const char* format, ...) const;
+   void progress(const double fraction) const;
+   double evaluate(const Params& params) const;
+   void count_evaluations(const size_t N) const;
+   void report(const FitPhase phase, const size_t iteration, const double value, const Params& params) const;
+   bool in_parallel_part() const;
+   int threads() const;
+   double crossing(const Params& fitted_params, const size_t i, const double first_step, const double target) const;
+   void plot_parameter_scan(const Params& fitted_params, const size_t i, const double chisq_min) const;
+
    FunctionToMinimise function_to_minimise;  // pointer to the function we're minimising (chi squared)
+   BatchFunctionToMinimise batch_function_to_minimise; // the same for many param sets at once, or nullptr
    std::string m_function_name;              // eg "chi squared"
    ModelFunction model_function;             // function ptr to output y as a function of x (linear/cubic/whatever)
+   ModelGradient model_gradient;             // function ptr to dy/dp of the model, or nullptr for finite differences
+   MinimisationMethod m_method;              // what to do after the grid search
+   ErrorMethod m_error_method;               // how find_parameter_errors() gets its answers
+   GlobalMethod m_global_method;             // how minimise() finds somewhere to start from
+   size_t m_global_population;               // number of starts/DE members/SA chains, 0 to pick from N_params
+   size_t m_global_iterations;               // DE generations or SA temperature steps
+   uint64_t m_seed;                          // for the random numbers in the global methods
+   int m_N_threads;                          // each parallel part's team size, 0 for omp_get_max_threads()
+   bool m_quiet;                             // suppress all printing
+   double m_progress_interval;               // minimum seconds between progress updates
+   mutable double m_last_progress;           // when the last one was printed
+   FitObserver m_observer;                   // called on every step, or nullptr
+   void* m_observer_data;                    // passed back to m_observer untouched
+   mutable FitTelemetry m_telemetry;         // counters, timings and trace of the last fit
+   int m_base_level;                         // openmp nesting level the fit was started from
    std::string m_model_func_name;            // eg "linear"
    std::string m_model_description;          // eg "y = a + b*x"
    DataPoints m_datapoints;                  // x, y values of dataset to minimise params for
+   EArray m_unweighted_e;                    // original errors once set_point_weights() has changed them
    size_t m_iterations_curr;                 // current count of completed iterations
    size_t m_iterations_max;                  // max times to iterate on the params
    double m_epsilon;                         // error acceptability limit
    Params m_params_curr;                     // current (iterated) values of parameters
+   double m_value_curr;                      // function value at m_params_curr once minimise() is done
    Params m_params_max;                      // given limits of parameters to work within
    size_t m_N_grid_volumes;                  // number of volumes to check along each dof during initial grid search
    Params m_params_min;                      // parameters at minimum value
+   Params m_errors_plus;                     // distance from the fitted params up to delta(function)=1
+   Params m_errors_minus;                    // and down to it
+   SquareMatrix m_covariance;                // parameter covariance matrix from the hessian
 };
 
 #endif
\ No newline at end of file
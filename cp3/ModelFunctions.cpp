@@ -2,97 +2,106 @@
 #include "../global.h"
 #include "ModelFunctions.h"
 
+/*
+   The fixed-size models are each defined once as a struct in ModelFunctions.h. These are the plain function 
+   versions of them, for passing around as ModelFunction/ModelGradient pointers
+*/
+
 // y = a + bx
 double linear(const double x, const Params& params) {
-   ASSERT( params.size() == 2 );
-   const double a = params[0];
-   const double b = params[1];
-   return a + b*x;
+   return model_value<Linear>(x, params);
+}
+
+void linear_gradient(const double x, const Params& params, Params* gradient) {
+   model_gradient<Linear>(x, params, gradient);
 }
 
-// y = a + bx^2
+// y = a + bx + cx^2
 double quadratic(const double x, const Params& params) {
-   ASSERT( params.size() == 3 );
-   const double a = params[0];
-   const double b = params[1];
-   const double c = params[2];
-   return a + b*x + c*x*x;
+   return model_value<Quadratic>(x, params);
+}
+
+void quadratic_gradient(const double x, const Params& params, Params* gradient) {
+   model_gradient<Quadratic>(x, params, gradient);
 }
 
-// y = a + bx^2 + cx^3
+// y = a + bx + cx^2 + dx^3
 double cubic(const double x, const Params& params) {
-   ASSERT( params.size() == 4 );
-   const double a = params[0];
-   const double b = params[1];
-   const double c = params[2];
-   const double d = params[3];
-   return a + b*x + c*x*x + d*x*x*x;
+   return model_value<Cubic>(x, params);
 }
 
-// generalisation of linear/quad/cubic for arbitrary number of parameters (at least 1)
-double polynomial(const double x, const Params& params) {
-   ASSERT( params.size() >= 1 );
-   double sum = 0.0;
-   for (size_t i = 0; i < params.size(); i++) {
-      sum += params[i] * pow(x, i);
-   }
-   return sum;
+void cubic_gradient(const double x, const Params& params, Params* gradient) {
+   model_gradient<Cubic>(x, params, gradient);
 }
 
 // y = a + b*sin(c*x+d)
 double sinusoidal(const double x, const Params& params) {
-   ASSERT( params.size() == 4 );
-   const double a = params[0];
-   const double b = params[1];
-   const double c = params[2];
-   const double d = params[3];
-   return a + b*sin(c*x + d);
+   return model_value<Sinusoidal>(x, params);
+}
+
+void sinusoidal_gradient(const double x, const Params& params, Params* gradient) {
+   model_gradient<Sinusoidal>(x, params, gradient);
 }
 
 // y = a + b*x^(c)
 double power(const double x, const Params& params) {
-   ASSERT( params.size() == 3 );
-   const double a = params[0];
-   const double b = params[1];
-   const double c = params[2];
-   return a + b*pow(x, c);
+   return model_value<Power>(x, params);
 }
 
-// y = a + b*c^x
+void power_gradient(const double x, const Params& params, Params* gradient) {
+   model_gradient<Power>(x, params, gradient);
+}
+
+// y = a + b*c^(d*x)
 double exponential(const double x, const Params& params) {
-   ASSERT( params.size() == 4 );
-   const double a = params[0];
-   const double b = params[1];
-   const double c = params[2];
-   const double d = params[3];
-   return a + b*pow(c, d*x);
+   return model_value<Exponential>(x, params);
+}
+
+void exponential_gradient(const double x, const Params& params, Params* gradient) {
+   model_gradient<Exponential>(x, params, gradient);
 }
 
 // y = a + b*log(c*x + d)
 double logarithmic(const double x, const Params& params) {
-   ASSERT( params.size() == 4 );
-   const double a = params[0];
-   const double b = params[1];
-   const double c = params[2];
-   const double d = params[3];
-   return a + b*log(c*x + d);
+   return model_value<Logarithmic>(x, params);
+}
+
+void logarithmic_gradient(const double x, const Params& params, Params* gradient) {
+   model_gradient<Logarithmic>(x, params, gradient);
 }
 
 // y = a + b*exp(0.5* [(x-c)/d]^2 )
 double gaussian(const double x, const Params& params) {
-   ASSERT( params.size() == 4 );
-   const double a = params[0];
-   const double b = params[1];
-   const double c = params[2];
-   const double d = params[3];
-   return a + b*exp( -0.5 * pow((x-c)/d, 2.0) );
+   return model_value<Gaussian>(x, params);
+}
+
+void gaussian_gradient(const double x, const Params& params, Params* gradient) {
+   model_gradient<Gaussian>(x, params, gradient);
 }
 
 // y = { a  for x < c } or { b  for x > c }
 double step(const double x, const Params& params) {
-   ASSERT( params.size() == 3 );
-   const double a = params[0];
-   const double b = params[1];
-   const double c = params[2];
-   return (x < c) ? a : b;
+   return model_value<Step>(x, params);
+}
+
+void step_gradient(const double x, const Params& params, Params* gradient) {
+   model_gradient<Step>(x, params, gradient);
+}
+
+// generalisation of linear/quad/cubic for arbitrary number of parameters (at least 1). Polynomial<Degree> in the
+// header does the same when the degree is known at compile time
+double polynomial(const double x, const Params& params) {
+   ASSERT( params.size() >= 1 );
+   return horner(x, params.data(), params.size());
+}
+
+// dy/dp_i = x^i, built up by repeated multiplication rather than pow()
+void polynomial_gradient(const double x, const Params& params, Params* gradient) {
+   ASSERT( params.size() >= 1 );
+   gradient->resize(params.size());
+   double x_to_the_i = 1.0;
+   for (size_t i = 0; i < params.size(); i++) {
+      (*gradient)[i] = x_to_the_i;
+      x_to_the_i *= x;
+   }
 }
\ No newline at end of file
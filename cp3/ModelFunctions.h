@@ -1,7 +1,9 @@
 #ifndef MODELFUNCTION_H
 #define MODELFUNCTION_H
 
+#include <math.h>
 #include "../global.h"
+#include "../vecmath.h"
 
 double linear     (const double x, const Params& params);   // y = a + bx
 double quadratic  (const double x, const Params& params);   // y = a + bx + cx^2
@@ -14,4 +16,176 @@ double logarithmic(const double x, const Params& params);   // y = a + b*log(c*x
 double gaussian   (const double x, const Params& params);   // y = a + b*exp(0.5* [(x-c)/d]^2 )
 double step       (const double x, const Params& params);   // y = { a if x < c } or { b for x > c }
 
-#endif
\ No newline at end of file
+// dy/dp of each of the above with respect to every parameter, matching the ModelGradient typedef
+void linear_gradient     (const double x, const Params& params, Params* gradient);
+void quadratic_gradient  (const double x, const Params& params, Params* gradient);
+void cubic_gradient      (const double x, const Params& params, Params* gradient);
+void polynomial_gradient (const double x, const Params& params, Params* gradient);
+void sinusoidal_gradient (const double x, const Params& params, Params* gradient);
+void power_gradient      (const double x, const Params& params, Params* gradient);
+void exponential_gradient(const double x, const Params& params, Params* gradient);
+void logarithmic_gradient(const double x, const Params& params, Params* gradient);
+void gaussian_gradient   (const double x, const Params& params, Params* gradient);
+void step_gradient       (const double x, const Params& params, Params* gradient);
+
+
+
+// p[0] + p[1]*x + p[2]*x^2 + ... + p[n-1]*x^(n-1) by Horner's method, one multiply-add per term and no pow()
+inline double horner(const double x, const double* p, const size_t n) {
+   double sum = p[n-1];
+   for (size_t i = n-1; i-- > 0; ) sum = sum*x + p[i];
+   return sum;
+}
+
+/*
+   Compile-time versions of the models above, which the functions above are now just wrappers around. Each struct 
+   has its parameter count N, the name Minimiser knows it by, and static value()/gradient() functions that take a 
+   plain array of N parameters. Passed as template arguments (see ChiSquared.h and Minimiser::set_model()) they get 
+   inlined into the loop over data points, rather than being called through a function pointer and checking 
+   params.size() once per point. Their exp/log/pow/sin/cos are the ones from vecmath.h, so that loop still 
+   vectorises, with the same answers as libm's for negative bases and other special cases
+*/
+struct Linear {
+   static const size_t N = 2;
+   static const char* name() { return "linear"; }
+   static double value(const double x, const double* p) { return p[0] + p[1]*x; }
+   static void gradient(const double x, const double* p, double* g) {
+      g[0] = 1.0;
+      g[1] = x;
+   }
+};
+
+struct Quadratic {
+   static const size_t N = 3;
+   static const char* name() { return "quadratic"; }
+   static double value(const double x, const double* p) { return p[0] + x*(p[1] + x*p[2]); }
+   static void gradient(const double x, const double* p, double* g) {
+      g[0] = 1.0;
+      g[1] = x;
+      g[2] = x*x;
+   }
+};
+
+struct Cubic {
+   static const size_t N = 4;
+   static const char* name() { return "cubic"; }
+   static double value(const double x, const double* p) { return p[0] + x*(p[1] + x*(p[2] + x*p[3])); }
+   static void gradient(const double x, const double* p, double* g) {
+      g[0] = 1.0;
+      g[1] = x;
+      g[2] = x*x;
+      g[3] = x*x*x;
+   }
+};
+
+// Degree is fixed at compile time so the Horner loop unrolls completely
+template<size_t Degree>
+struct Polynomial {
+   static const size_t N = Degree + 1;
+   static const char* name() { return "polynomial"; }
+   static double value(const double x, const double* p) { return horner(x, p, N); }
+   static void gradient(const double x, const double* p, double* g) {
+      double x_to_the_i = 1.0;
+      for (size_t i = 0; i < N; i++) {
+         g[i] = x_to_the_i;
+         x_to_the_i *= x;
+      }
+   }
+};
+
+struct Sinusoidal {
+   static const size_t N = 4;
+   static const char* name() { return "sinusoidal"; }
+   static double value(const double x, const double* p) { return p[0] + p[1]*vm_sin(p[2]*x + p[3]); }
+   static void gradient(const double x, const double* p, double* g) {
+      const double cosine = vm_cos(p[2]*x + p[3]);
+      g[0] = 1.0;
+      g[1] = vm_sin(p[2]*x + p[3]);
+      g[2] = p[1] * x * cosine;
+      g[3] = p[1] * cosine;
+   }
+};
+
+struct Power {
+   static const size_t N = 3;
+   static const char* name() { return "power"; }
+   static double value(const double x, const double* p) { return p[0] + p[1]*vm_pow(x, p[2]); }
+   static void gradient(const double x, const double* p, double* g) {
+      const double x_to_the_c = vm_pow(x, p[2]);
+      g[0] = 1.0;
+      g[1] = x_to_the_c;
+      g[2] = p[1] * x_to_the_c * vm_log(x);
+   }
+};
+
+// y = a + b*c^(d*x)
+struct Exponential {
+   static const size_t N = 4;
+   static const char* name() { return "exponential"; }
+   static double value(const double x, const double* p) { return p[0] + p[1]*vm_pow(p[2], p[3]*x); }
+   static void gradient(const double x, const double* p, double* g) {
+      const double c_to_the_dx = vm_pow(p[2], p[3]*x);
+      g[0] = 1.0;
+      g[1] = c_to_the_dx;
+      g[2] = p[1] * p[3] * x * c_to_the_dx / p[2];
+      g[3] = p[1] * x * vm_log(p[2]) * c_to_the_dx;
+   }
+};
+
+struct Logarithmic {
+   static const size_t N = 4;
+   static const char* name() { return "logarithmic"; }
+   static double value(const double x, const double* p) { return p[0] + p[1]*vm_log(p[2]*x + p[3]); }
+   static void gradient(const double x, const double* p, double* g) {
+      const double argument = p[2]*x + p[3];
+      g[0] = 1.0;
+      g[1] = vm_log(argument);
+      g[2] = p[1] * x / argument;
+      g[3] = p[1] / argument;
+   }
+};
+
+struct Gaussian {
+   static const size_t N = 4;
+   static const char* name() { return "gaussian"; }
+   static double value(const double x, const double* p) {
+      const double z = (x - p[2]) / p[3];
+      return p[0] + p[1]*vm_exp( -0.5 * z*z );
+   }
+   static void gradient(const double x, const double* p, double* g) {
+      const double z = (x - p[2]) / p[3];
+      const double e = vm_exp( -0.5 * z*z );
+      g[0] = 1.0;
+      g[1] = e;
+      g[2] = p[1] * e * z / p[3];
+      g[3] = p[1] * e * z*z / p[3];
+   }
+};
+
+// the step position c has no gradient anywhere except exactly on the step, so it's left at zero
+struct Step {
+   static const size_t N = 3;
+   static const char* name() { return "step"; }
+   static double value(const double x, const double* p) { return (x < p[2]) ? p[0] : p[1]; }
+   static void gradient(const double x, const double* p, double* g) {
+      g[0] = (x < p[2]) ? 1.0 : 0.0;
+      g[1] = (x < p[2]) ? 0.0 : 1.0;
+      g[2] = 0.0;
+   }
+};
+
+// ModelFunction/ModelGradient shaped wrappers around any of the structs above, for code that needs a pointer
+template<class Model>
+double model_value(const double x, const Params& params) {
+   ASSERT( params.size() == Model::N );
+   return Model::value(x, params.data());
+}
+
+template<class Model>
+void model_gradient(const double x, const Params& params, Params* gradient) {
+   ASSERT( params.size() == Model::N );
+   gradient->resize(Model::N);
+   Model::gradient(x, params.data(), gradient->data());
+}
+
+#endif
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include "NumberParser.h"
+
+// every power of ten that a double holds exactly
+static const double exact_powers_of_ten[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                              1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+// copies the token into a null terminated buffer for strtod, since the text itself might not have one
+static bool parse_double_fallback(const char* start, const char* end, const char** after, double* value) {
+   const char* token_end = start;
+   while (token_end < end && !is_blank(*token_end) && *token_end != '\n') token_end++;
+   const std::string token(start, token_end);
+   char* parse_end;
+   *value = strtod(token.c_str(), &parse_end);
+   if (parse_end == token.c_str()) return false;
+   *after = start + (parse_end - token.c_str());
+   return true;
+}
+
+bool parse_double(const char** p, 
+                  const char* end, 
+       /*output*/ double* value) {
+   const char* c = *p;
+   while (c < end && is_blank(*c)) c++;
+   const char* start = c;
+   if (c == end) return false;
+
+   bool negative = false;
+   if (*c == '-' || *c == '+') {
+      negative = (*c == '-');
+      c++;
+   }
+
+   // mantissa digits, ignoring the decimal point but remembering how many came after it
+   uint64_t mantissa = 0;
+   size_t N_digits = 0, N_significant = 0;
+   int exponent = 0;
+   for (; c < end && *c >= '0' && *c <= '9'; c++, N_digits++) {
+      if (mantissa == 0 && *c == '0') continue; // leading zeros don't count towards the precision
+      if (N_significant++ < 19) mantissa = mantissa*10 + (*c - '0');
+      else                      exponent++;    // too many to hold, strtod gets it below
+   }
+   if (c < end && *c == '.') {
+      for (c++; c < end && *c >= '0' && *c <= '9'; c++, N_digits++) {
+         if (mantissa == 0 && *c == '0') { exponent--; continue; }
+         if (N_significant++ < 19) { mantissa = mantissa*10 + (*c - '0'); exponent--; }
+      }
+   }
+   if (N_digits == 0) return parse_double_fallback(start, end, p, value); // inf, nan, or not a number at all
+
+   if (c < end && (*c == 'e' || *c == 'E')) {
+      const char* e = c + 1;
+      bool negative_exponent = false;
+      if (e < end && (*e == '-' || *e == '+')) {
+         negative_exponent = (*e == '-');
+         e++;
+      }
+      if (e < end && *e >= '0' && *e <= '9') {
+         int exponent_value = 0;
+         for (; e < end && *e >= '0' && *e <= '9'; e++) {
+            if (exponent_value < 100000) exponent_value = exponent_value*10 + (*e - '0');
+         }
+         exponent += negative_exponent ? -exponent_value : exponent_value;
+         c = e;
+      } // otherwise the 'e' isn't part of this number
+   }
+
+   // exact when both the mantissa and 10^|exponent| are exact doubles, since IEEE multiply and divide round correctly
+   if (N_significant > 19 || mantissa > (1ull << 53) || exponent < -22 || exponent > 22) {
+      return parse_double_fallback(start, end, p, value);
+   }
+   double result = (double)mantissa;
+   if (exponent < 0) result /= exact_powers_of_ten[-exponent];
+   else              result *= exact_powers_of_ten[exponent];
+   *value = negative ? -result : result;
+   *p = c;
+   return true;
+}
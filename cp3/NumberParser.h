@@ -0,0 +1,16 @@
+#ifndef NUMBERPARSER_H
+#define NUMBERPARSER_H
+
+#include <stddef.h>
+
+// whitespace as far as the data files are concerned, anything that can separate two numbers on a line
+inline bool is_blank(const char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+/* Parses one number starting at *p, not reading past end (the text doesn't need to be null terminated, so this works 
+   straight on a mmapped file). Leading blanks are skipped and *p is left just after the number. Most numbers in a 
+   data file have under 16 significant digits and a small exponent, and those are converted exactly with a single 
+   multiply or divide by a power of ten. Anything else (long mantissas, big exponents, inf/nan) goes to strtod, so 
+   the result is always correctly rounded. Returns false if there was no number to read */
+bool parse_double(const char** p, const char* end, /*output*/ double* value);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef OBJECTIVE_H
+#define OBJECTIVE_H
+
+#include "../global.h"
+#include "DataPoints.h"
+#include "ChiSquared.h"
+
+/*
+   The function being minimised packaged up with the data and model it needs, so it can be called with nothing but 
+   a plain array of parameters. That's the double(const double*) signature external minimisers like Minuit2 take 
+   (ROOT::Math::Functor will wrap either of these), and since each object carries its own data rather than reading a 
+   global, any number of them can run at once. Both hold a pointer to the DataPoints rather than a copy, because 
+   the minimisers copy the functor itself around; the data has to outlive them
+*/
+
+// any FunctionToMinimise/ModelFunction pair, e.g. the ones a Minimiser is set up with
+class Objective {
+public:
+   Objective(const DataPoints& data, FunctionToMinimise function, ModelFunction model, const size_t N_params)
+      : m_data(&data), m_function(function), m_model(model), m_N_params(N_params) { }
+
+   double operator()(const double* params) const {
+      const Params p(params, params + m_N_params);
+      return m_function(*m_data, p, m_model);
+   }
+   size_t size() const { return m_N_params; }
+
+private:
+   const DataPoints* m_data;
+   FunctionToMinimise m_function;
+   ModelFunction m_model;
+   size_t m_N_params;
+};
+
+// chi squared against one of the model structs in ModelFunctions.h, with no Params allocated per call
+template<class Model>
+class ModelObjective {
+public:
+   ModelObjective(const DataPoints& data) : m_data(&data) { 
+      ASSERT( data.has_inverse_errors() ); // call data.update_inverse_errors() first if this trips
+   }
+
+   double operator()(const double* params) const {
+      const DataPoints& d = *m_data;
+      return chisq_block<Model>(d.x.data(), d.y.data(), d.inv_e.data(), 0, d.x.size(), params);
+   }
+   size_t size() const { return Model::N; }
+
+private:
+   const DataPoints* m_data;
+};
+
+#endif
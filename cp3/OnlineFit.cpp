@@ -0,0 +1,127 @@
+#include <cmath>
+#include "OnlineFit.h"
+
+RecursiveLeastSquares::RecursiveLeastSquares(const size_t N_params, const double forgetting) 
+      : m_N_params(N_params), m_forgetting(forgetting), m_ready(false), m_N_points(0), 
+        m_params(N_params, 0.0), m_P(N_params, 0.0), m_b(N_params, 0.0), m_chisq(0.0), 
+        m_P_phi(N_params, 0.0) {
+   ASSERT( N_params >= 1 );
+   ASSERT( forgetting > 0.0 && forgetting <= 1.0 );
+}
+
+/* Rotates the row sqrt(w)*(phi, y) into the triangle [R|z] kept in m_P and m_b, with Givens rotations that zero its 
+   entries one column at a time. Whatever is left in its y position once every column is zeroed is its contribution 
+   to the residual, so chisq comes out as a plain sum of squares. A row that reaches an empty row of R with a 
+   non-zero leading entry fills it instead, raising the rank. Returns true if it did */
+bool RecursiveLeastSquares::rotate_in(const double* phi, const double y, const double w) {
+   const size_t N = m_N_params;
+   const double root_lambda = sqrt(m_forgetting);
+   const double root_w = sqrt(w);
+   double norm = 0.0; // of all the rows so far, which the rotations preserve, to tell rounding from a new direction
+   for (size_t j = 0; j < N; j++) {
+      for (size_t k = j; k < N; k++) {
+         m_P(j,k) *= root_lambda;
+         norm += m_P(j,k) * m_P(j,k);
+      }
+      m_b[j] *= root_lambda;
+      m_P_phi[j] = root_w * phi[j];
+      norm += m_P_phi[j] * m_P_phi[j];
+   }
+   m_chisq *= m_forgetting;
+   double row_y = root_w * y;
+   const double tolerance = 1e-12 * sqrt(norm);
+
+   for (size_t j = 0; j < N; j++) {
+      if (m_P(j,j) == 0.0) {
+         if (fabs(m_P_phi[j]) <= tolerance) { // in the span of the rows so far, as far as rounding can tell
+            m_P_phi[j] = 0.0;
+            continue;
+         }
+         for (size_t k = j; k < N; k++) m_P(j,k) = m_P_phi[k];
+         m_b[j] = row_y;
+         return true;
+      }
+      const double r = hypot(m_P(j,j), m_P_phi[j]);
+      const double c = m_P(j,j) / r, s = m_P_phi[j] / r;
+      for (size_t k = j; k < N; k++) {
+         const double a = m_P(j,k);
+         m_P(j,k)    =  c*a + s*m_P_phi[k];
+         m_P_phi[k] = -s*a + c*m_P_phi[k];
+      }
+      const double a = m_b[j];
+      m_b[j] =  c*a + s*row_y;
+      row_y  = -s*a + c*row_y;
+   }
+   m_chisq += row_y * row_y;
+   return false;
+}
+
+void RecursiveLeastSquares::add(const double* phi, const double y, const double e) {
+   const size_t N = m_N_params;
+   const double w = 1.0 / (e*e);
+   const double lambda = m_forgetting;
+   m_N_points++;
+
+   if (!m_ready) {
+      // not enough points yet, so just build up R. Only a point that raises its rank can make it invertible
+      if (!rotate_in(phi, y, w)) return;
+      for (size_t j = 0; j < N; j++) {
+         if (m_P(j,j) == 0.0) return;
+      }
+      // R*p = z by back substitution, and P = (R^T*R)^-1 = R^-1*R^-T from the inverse of the triangle
+      SquareMatrix R_inverse(N, 0.0);
+      for (size_t j = N; j-- > 0; ) {
+         double sum = m_b[j];
+         for (size_t k = j+1; k < N; k++) sum -= m_P(j,k) * m_params[k];
+         m_params[j] = sum / m_P(j,j);
+         R_inverse(j,j) = 1.0 / m_P(j,j);
+         for (size_t c = j+1; c < N; c++) {
+            double entry = 0.0;
+            for (size_t k = j+1; k <= c; k++) entry -= m_P(j,k) * R_inverse(k,c);
+            R_inverse(j,c) = entry / m_P(j,j);
+         }
+      }
+      for (size_t j = 0; j < N; j++) {
+         for (size_t k = 0; k <= j; k++) {
+            double sum = 0.0;
+            for (size_t m = j; m < N; m++) sum += R_inverse(j,m) * R_inverse(k,m);
+            m_P(j,k) = sum;
+            m_P(k,j) = sum;
+         }
+      }
+      m_ready = true;
+      return;
+   }
+
+   // r is the prediction error for the new point, P*phi/(lambda/w + phi^T*P*phi) the gain to apply it with
+   double r = y, phi_P_phi = 0.0;
+   for (size_t j = 0; j < N; j++) {
+      r -= phi[j] * m_params[j];
+      double sum = 0.0;
+      for (size_t k = 0; k < N; k++) sum += m_P(j,k) * phi[k];
+      m_P_phi[j] = sum;
+      phi_P_phi += phi[j] * sum;
+   }
+   const double denominator = lambda/w + phi_P_phi;
+   for (size_t j = 0; j < N; j++) m_params[j] += m_P_phi[j] * r / denominator;
+   // P = (P - P*phi*phi^T*P/denominator)/lambda, worked out on one triangle and mirrored so it stays symmetric
+   for (size_t j = 0; j < N; j++) {
+      for (size_t k = 0; k <= j; k++) {
+         const double value = (m_P(j,k) - m_P_phi[j]*m_P_phi[k]/denominator) / lambda;
+         m_P(j,k) = value;
+         m_P(k,j) = value;
+      }
+   }
+   // the minimum of sum lambda^age*w*r^2 goes up by lambda*r^2/denominator, with r the prediction error
+   m_chisq = lambda*m_chisq + lambda*r*r / denominator;
+}
+
+Params StreamingFitter::refit() {
+   if (m_fitted) {
+      m_minimiser.minimise_from(m_minimiser.get_final_parameters());
+   } else {
+      m_minimiser.minimise();
+      m_fitted = true;
+   }
+   return m_minimiser.get_final_parameters();
+}
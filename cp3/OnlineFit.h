@@ -0,0 +1,85 @@
+#ifndef ONLINEFIT_H
+#define ONLINEFIT_H
+
+#include <vector>
+#include "../global.h"
+#include "DataPoints.h"
+#include "SquareMatrix.h"
+#include "Minimiser.h"
+#include "LinearLeastSquares.h"
+
+/*
+   Recursive least squares for models that are linear in their parameters, y = sum p_j*phi_j(x). Points go in one 
+   at a time as their basis values phi, and the weighted least squares answer is kept up to date after each one. 
+   Until there are enough points to pin every parameter down, they're rotated into the triangular factor R of the 
+   weighted design matrix (a QR factorisation built row by row), which shows exactly when a point adds a new 
+   direction and gives their chisq without cancellation, in O(N_params^2) memory however long that takes. Once R 
+   is full rank, P = (R^T*R)^-1 (which is also the covariance) and the parameters are updated with the rank-1 
+   Sherman-Morrison formula, so each point costs O(N_params^2) however many came before it. The answer is the same 
+   as refitting everything from scratch, up to rounding. A forgetting factor below 1 weights older points down 
+   geometrically, for data whose parameters drift
+*/
+class RecursiveLeastSquares {
+public:
+   RecursiveLeastSquares(const size_t N_params, const double forgetting = 1.0);
+
+   void add(const double* phi, const double y, const double e);
+
+   bool ready() const               { return m_ready; }  // false until the parameters are determined
+   const Params& parameters() const { return m_params; }
+   const SquareMatrix& covariance() const { return m_P; }
+   double chisq() const             { return m_chisq; }
+   size_t size() const              { return m_N_points; }
+
+private:
+   bool rotate_in(const double* phi, const double y, const double w);
+
+   size_t m_N_params;
+   double m_forgetting;
+   bool m_ready;
+   size_t m_N_points;
+   Params m_params;
+   SquareMatrix m_P;       // inverse of the (weighted) normal matrix once ready, R in the upper triangle before that
+   Params m_b;             // Q^T*sqrt(w)*y to go with R, only needed before ready
+   double m_chisq;         // weighted (and forgotten) sum of squared residuals, kept up to date point by point
+   Params m_P_phi;         // scratch
+};
+
+// RecursiveLeastSquares for one of the linear-in-parameters model structs, fed with x values directly
+template<class Model>
+class OnlineLeastSquares : public RecursiveLeastSquares {
+public:
+   OnlineLeastSquares(const double forgetting = 1.0) : RecursiveLeastSquares(Model::N, forgetting) { }
+
+   void add(const double x, const double y, const double e) {
+      double phi[Model::N];
+      ModelBasis<Model>()(x, phi);
+      RecursiveLeastSquares::add(phi, y, e);
+   }
+   void add(const DataPoints& data) {
+      for (size_t i = 0; i < data.x.size(); i++) add(data.x[i], data.y[i], data.e[i]);
+   }
+};
+
+/*
+   For models that aren't linear in their parameters: keeps a Minimiser whose dataset grows as points arrive. The 
+   first refit() is a full minimise() with whatever global method the config has. After that, each refit starts the 
+   local minimisation from the last answer, which is normally only a step or two from the new minimum, so the cost 
+   of a refresh is a few passes over the data rather than a whole global search
+*/
+class StreamingFitter {
+public:
+   StreamingFitter(const Minimiser& config) : m_minimiser(config), m_fitted(false) { m_minimiser.set_quiet(true); }
+
+   void add(const DataPoints& points) { m_minimiser.add_datapoints(points); }
+   Params refit();
+   void reset() { m_fitted = false; } // next refit() does the global search again, e.g. if the data has jumped
+
+   const Minimiser& minimiser() const { return m_minimiser; }
+
+private:
+   Minimiser m_minimiser;
+   bool m_fitted;
+};
+
+#endif
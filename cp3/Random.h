@@ -0,0 +1,41 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+/* Counter-based random numbers: the n'th number of stream s under a given seed is a hash of (seed, s, n), so any 
+   thread can produce any stream without sharing state. Give each independent piece of work (a chain, a population 
+   member, a starting point) its own stream and the results don't depend on how the work is split between threads. 
+   The hash is splitmix64's finaliser, which passes BigCrush on a plain counter */
+class CounterRNG {
+public:
+   CounterRNG(const uint64_t seed, const uint64_t stream) 
+      : key(mix(seed ^ mix(stream + 0x632be59bd9b4e019ull))), counter(0) { }
+
+   static uint64_t mix(uint64_t z) {
+      z += 0x9e3779b97f4a7c15ull;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      return z ^ (z >> 31);
+   }
+
+   uint64_t next()                  { return mix(key + counter++); }
+   double uniform()                 { return (next() >> 11) * (1.0 / 9007199254740992.0); } // [0,1), 53 bits
+   double uniform(double a, double b) { return a + (b-a)*uniform(); }
+   size_t below(const size_t n)     { return (size_t)(uniform() * n); }                     // [0,n)
+
+private:
+   uint64_t key;
+   uint64_t counter;
+};
+
+/* What a CounterRNG stream is for. Each purpose gets its own seed hashed from the user's seed, so the streams of 
+   one have nothing to do with those of another, however each numbers its streams */
+enum RandomPurpose { LATIN_HYPERCUBE_RANDOMS = 1, DIFFERENTIAL_EVOLUTION_RANDOMS, SIMULATED_ANNEALING_RANDOMS, 
+                     MCMC_INITIAL_WALKERS, MCMC_STRETCH_MOVES };
+
+inline CounterRNG random_stream(const uint64_t seed, const RandomPurpose purpose, const uint64_t stream) {
+   return CounterRNG(CounterRNG::mix(seed + CounterRNG::mix(purpose)), stream);
+}
+
+#endif
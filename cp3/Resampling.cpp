@@ -0,0 +1,94 @@
+#include <cmath>
+#include <omp.h>
+#include "Resampling.h"
+#include "Random.h"
+
+// mean and covariance of the replicates, with the covariance scaled by factor/(N-1)
+static void replicate_statistics(const double factor, /*in/out*/ ResamplingResult* result) {
+   const size_t N = result->replicates.size();
+   const size_t N_params = result->fitted.size();
+   result->mean.assign(N_params, 0.0);
+   for (const Params& p : result->replicates) {
+      for (size_t j = 0; j < N_params; j++) result->mean[j] += p[j] / N;
+   }
+   result->covariance = SquareMatrix(N_params, 0.0);
+   for (const Params& p : result->replicates) {
+      for (size_t j = 0; j < N_params; j++) {
+         for (size_t k = 0; k < N_params; k++) {
+            result->covariance(j,k) += (p[j] - result->mean[j]) * (p[k] - result->mean[k]);
+         }
+      }
+   }
+   result->errors.assign(N_params, 0.0);
+   for (size_t j = 0; j < N_params; j++) {
+      for (size_t k = 0; k < N_params; k++) result->covariance(j,k) *= factor / MAX( N-1, (size_t)1 );
+      result->errors[j] = sqrt(result->covariance(j,j));
+   }
+}
+
+// fits the full dataset with a quiet copy of config, which the replicates are then copied from
+static Minimiser full_fit(const Minimiser& config, const DataPoints& data, /*output*/ ResamplingResult* result) {
+   Minimiser m(config);
+   m.set_quiet(true);
+   m.set_observer(nullptr, nullptr);
+   m.set_datapoints(data);
+   m.minimise();
+   result->fitted = m.get_final_parameters();
+   return m;
+}
+
+ResamplingResult bootstrap(const Minimiser& config, 
+                           const DataPoints& data, 
+                           const size_t N_replicates, 
+                           const uint64_t seed) {
+   ResamplingResult result;
+   const Minimiser fitted = full_fit(config, data, &result);
+   result.replicates.resize(N_replicates);
+   const size_t N_points = data.x.size();
+
+   #pragma omp parallel
+   {
+      Minimiser m(fitted);
+      std::vector<double> counts(N_points);
+      #pragma omp for schedule(dynamic)
+      for (size_t r = 0; r < N_replicates; r++) {
+         CounterRNG rng(seed, r);
+         std::fill(counts.begin(), counts.end(), 0.0);
+         for (size_t i = 0; i < N_points; i++) counts[rng.below(N_points)] += 1.0;
+         m.set_point_weights(counts);
+         m.minimise_from(result.fitted);
+         result.replicates[r] = m.get_final_parameters();
+      }
+   }
+   replicate_statistics(1.0, &result);
+   return result;
+}
+
+ResamplingResult jackknife(const Minimiser& config, 
+                           const DataPoints& data, 
+                           const size_t N_groups) {
+   ResamplingResult result;
+   const Minimiser fitted = full_fit(config, data, &result);
+   const size_t N_points = data.x.size();
+   const size_t N = (N_groups == 0) ? N_points : MIN( N_groups, N_points );
+   ASSERT( N >= 2 );
+   result.replicates.resize(N);
+
+   #pragma omp parallel
+   {
+      Minimiser m(fitted);
+      std::vector<double> weights(N_points, 1.0);
+      #pragma omp for schedule(dynamic)
+      for (size_t g = 0; g < N; g++) {
+         const size_t first = N_points * g / N, last = N_points * (g+1) / N;
+         std::fill(weights.begin() + first, weights.begin() + last, 0.0);
+         m.set_point_weights(weights);
+         m.minimise_from(result.fitted);
+         result.replicates[g] = m.get_final_parameters();
+         std::fill(weights.begin() + first, weights.begin() + last, 1.0);
+      }
+   }
+   // (N-1)/N * sum of squares, where replicate_statistics() divides by N-1
+   replicate_statistics((N-1)*(N-1) / (double)N, &result);
+   return result;
+}
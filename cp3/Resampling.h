@@ -0,0 +1,37 @@
+#ifndef RESAMPLING_H
+#define RESAMPLING_H
+
+#include <vector>
+#include <stdint.h>
+#include "../global.h"
+#include "DataPoints.h"
+#include "Minimiser.h"
+#include "SquareMatrix.h"
+
+// parameter uncertainties from refitting many resampled versions of the data
+struct ResamplingResult {
+   Params fitted;                   // fit to the full dataset, which every replicate is started from
+   Params mean;                     // average of the replicate fits
+   SquareMatrix covariance;         // of the parameters, from the spread of the replicates, correlations and all
+   Params errors;                   // sqrt of the covariance diagonal
+   std::vector<Params> replicates;  // every replicate's fitted parameters
+};
+
+/* Bootstrap: N_replicates times, draw as many points as there are with replacement and refit. A resample is just a
+   count of how many times each point was drawn, which goes in as that point's weight on chisq, so the data itself 
+   is never copied. Replicates are spread over threads, each thread keeping one Minimiser and one counts array for 
+   all of its replicates, and each refit is warm started from the full-data answer. Every replicate has its own 
+   random stream from seed, so the result is the same for any number of threads */
+ResamplingResult bootstrap(const Minimiser& config, 
+                           const DataPoints& data, 
+                           const size_t N_replicates, 
+                           const uint64_t seed = 1);
+
+/* Delete-a-group jackknife: the points are split into N_groups contiguous groups (0 = one per point) and the fit is 
+   redone with each group left out in turn, by giving those points zero weight. The covariance is the spread of 
+   those fits times (N_groups-1)/N_groups */
+ResamplingResult jackknife(const Minimiser& config, 
+                           const DataPoints& data, 
+                           const size_t N_groups = 0);
+
+#endif
@@ -0,0 +1,91 @@
+#include <cmath>
+#include <algorithm>
+#include "RobustFit.h"
+
+double default_tuning(const RobustLoss loss) {
+   switch (loss) {
+      case HUBER:  return 1.345;
+      case CAUCHY: return 2.385;
+      case TUKEY:  return 4.685;
+      default:     return 1.0;
+   }
+}
+
+double robust_weight(const RobustLoss loss, const double u, const double k) {
+   const double a = fabs(u) / k;
+   switch (loss) {
+      case HUBER:  return (a <= 1.0) ? 1.0 : 1.0 / a;
+      case CAUCHY: return 1.0 / (1.0 + a*a);
+      case TUKEY:  return (a < 1.0) ? (1.0 - a*a)*(1.0 - a*a) : 0.0;
+      default:     return 1.0;
+   }
+}
+
+RobustFitter::RobustFitter(const Minimiser& config, 
+                           const DataPoints& data, 
+                           const RobustLoss loss, 
+                           const double tuning) 
+      : m_minimiser(config), m_data(data), m_loss(loss), m_tuning(tuning > 0.0 ? tuning : default_tuning(loss)),
+        m_estimate_scale(true), m_max_iterations(50), m_tolerance(1e-8), m_scale(1.0), m_iterations(0),
+        m_residuals(data.x.size()), m_weights(data.x.size(), 1.0), m_abs_deviations(data.x.size()) {
+   m_minimiser.set_datapoints(data);
+   m_minimiser.set_quiet(true);
+}
+
+// residuals from params, the spread of them, and the weights that go with them
+void RobustFitter::update_weights(const Params& params) {
+   const ModelFunction model = m_minimiser.model();
+   const size_t N_points = m_data.x.size();
+   #pragma omp parallel for
+   for (size_t i = 0; i < N_points; i++) {
+      m_residuals[i] = (m_data.y[i] - model(m_data.x[i], params)) / m_data.e[i];
+   }
+
+   m_scale = 1.0;
+   if (m_estimate_scale && N_points > 0) {
+      // sigma = 1.4826 * median(|u - median(u)|), which is right for gaussian residuals and ignores outliers
+      std::copy(m_residuals.begin(), m_residuals.end(), m_abs_deviations.begin());
+      std::nth_element(m_abs_deviations.begin(), m_abs_deviations.begin() + N_points/2, m_abs_deviations.end());
+      const double median = m_abs_deviations[N_points/2];
+      for (size_t i = 0; i < N_points; i++) m_abs_deviations[i] = fabs(m_residuals[i] - median);
+      std::nth_element(m_abs_deviations.begin(), m_abs_deviations.begin() + N_points/2, m_abs_deviations.end());
+      const double mad_scale = 1.4826 * m_abs_deviations[N_points/2];
+      if (mad_scale > 0.0) m_scale = mad_scale; // more than half the points fit exactly otherwise, keep sigma = e
+   }
+
+   #pragma omp parallel for
+   for (size_t i = 0; i < N_points; i++) {
+      m_weights[i] = robust_weight(m_loss, m_residuals[i] / m_scale, m_tuning);
+   }
+}
+
+Params RobustFitter::fit() {
+   std::fill(m_weights.begin(), m_weights.end(), 1.0);
+   m_minimiser.set_point_weights(m_weights);
+   m_minimiser.minimise();
+   Params params = m_minimiser.get_final_parameters();
+   m_iterations = 0;
+   if (m_loss == GAUSSIAN_LOSS) {
+      update_weights(params);
+      return params;
+   }
+
+   while (m_iterations < m_max_iterations) {
+      m_iterations++;
+      update_weights(params);
+      m_minimiser.set_point_weights(m_weights);
+      m_minimiser.minimise_from(params);
+      const Params new_params = m_minimiser.get_final_parameters();
+
+      // relative for big params, absolute for ones near 0, which would never settle to a relative tolerance
+      double largest_change = 0.0;
+      for (size_t j = 0; j < params.size(); j++) {
+         const double change = fabs(new_params[j] - params[j]) / (fabs(params[j]) + 1.0);
+         largest_change = MAX( largest_change, change );
+      }
+      params = new_params;
+      if (largest_change < m_tolerance) break;
+   }
+   update_weights(params); // so residuals() and weights() go with the params being returned
+   return params;
+}
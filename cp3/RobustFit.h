@@ -0,0 +1,68 @@
+#ifndef ROBUSTFIT_H
+#define ROBUSTFIT_H
+
+#include <vector>
+#include "../global.h"
+#include "DataPoints.h"
+#include "Minimiser.h"
+
+// how hard outliers are pushed down, as a function of the residual in units of its error
+enum RobustLoss {
+   GAUSSIAN_LOSS, // plain chisq, every point weighted fully
+   HUBER,         // quadratic within k sigma, linear outside, so outliers count for less but never nothing
+   CAUCHY,        // weight 1/(1+(u/k)^2), heavy tailed
+   TUKEY          // tukey's biweight, points beyond k sigma are ignored completely
+};
+
+// the usual tuning constants, giving 95% efficiency on data with no outliers
+double default_tuning(const RobustLoss loss);
+
+// weight of a point whose standardised residual is u
+double robust_weight(const RobustLoss loss, const double u, const double k);
+
+/*
+   Robust fitting by iteratively reweighted least squares: fit, work out every point's standardised residual 
+   u = (y - f(x))/(e*scale), turn those into weights that shrink for outliers, and refit with the weights, until the 
+   parameters settle. scale is the spread of the residuals from their median absolute deviation (so it isn't thrown 
+   by the outliers themselves), or 1 if the errors are to be taken at face value. The first fit is a full 
+   minimise() with whatever global method config was given, and every refit is warm started from the last answer,
+   so the whole thing usually costs a few local minimisations. The residual, weight and sorting buffers are made 
+   once and reused on every iteration
+*/
+class RobustFitter {
+public:
+   RobustFitter(const Minimiser& config, 
+                const DataPoints& data, 
+                const RobustLoss loss, 
+                const double tuning = 0.0); // 0 = default_tuning(loss)
+
+   void set_estimate_scale(bool estimate)     { m_estimate_scale = estimate; }
+   void set_max_iterations(size_t max)        { m_max_iterations = max; }
+   void set_tolerance(double tolerance)       { m_tolerance = tolerance; } // on each param's change / (|param|+1)
+
+   Params fit();
+
+   const std::vector<double>& residuals() const { return m_residuals; } // standardised, from the final params
+   const std::vector<double>& weights() const   { return m_weights; }
+   double scale() const                         { return m_scale; }
+   size_t iterations() const                    { return m_iterations; }
+   const Minimiser& minimiser() const           { return m_minimiser; } // e.g. for the weighted covariance
+
+private:
+   void update_weights(const Params& params);
+
+   Minimiser m_minimiser;            // quiet copy of the config, holding the data and the current weights
+   const DataPoints& m_data;         // unweighted data, to work out the residuals from
+   RobustLoss m_loss;
+   double m_tuning;                  // k, in units of the residual's spread
+   bool m_estimate_scale;
+   size_t m_max_iterations;
+   double m_tolerance;
+   double m_scale;
+   size_t m_iterations;
+   std::vector<double> m_residuals;  // (y - f(x))/e for each point
+   std::vector<double> m_weights;
+   std::vector<double> m_abs_deviations; // scratch for finding the median
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include <math.h>
+#include "../global.h"
+#include "SquareMatrix.h"
+
+SquareMatrix SquareMatrix::identity(const size_t n) {
+   SquareMatrix output(n, 0.0);
+   for (size_t i = 0; i < n; i++) output(i, i) = 1.0;
+   return output;
+}
+
+Params SquareMatrix::operator*(const Params& v) const {
+   ASSERT( v.size() == N );
+   Params output(N, 0.0);
+   for (size_t r = 0; r < N; r++) {
+      double sum = 0.0;
+      for (size_t c = 0; c < N; c++) sum += (*this)(r, c) * v[c];
+      output[r] = sum;
+   }
+   return output;
+}
+
+// Cholesky-Banachiewicz, only looks at the lower triangle of this matrix
+bool SquareMatrix::cholesky(SquareMatrix* L) const {
+   *L = SquareMatrix(N, 0.0);
+   for (size_t r = 0; r < N; r++) {
+      for (size_t c = 0; c <= r; c++) {
+         double sum = (*this)(r, c);
+         for (size_t k = 0; k < c; k++) sum -= (*L)(r, k) * (*L)(c, k);
+         if (r == c) {
+            if (!(sum > 0.0)) return false; // also catches NaN
+            (*L)(r, r) = sqrt(sum);
+         } else {
+            (*L)(r, c) = sum / (*L)(c, c);
+         }
+      }
+   }
+   return true;
+}
+
+// forward then back substitution through an existing Cholesky factor L
+void SquareMatrix::substitute(const SquareMatrix& L, 
+                              const Params& b, 
+                   /*output*/ Params* x) {
+   const size_t N = L.size();
+   Params y(N, 0.0);
+   for (size_t r = 0; r < N; r++) {
+      double sum = b[r];
+      for (size_t k = 0; k < r; k++) sum -= L(r, k) * y[k];
+      y[r] = sum / L(r, r);
+   }
+   x->assign(N, 0.0);
+   for (size_t r = N; r-- > 0; ) {
+      double sum = y[r];
+      for (size_t k = r+1; k < N; k++) sum -= L(k, r) * (*x)[k];
+      (*x)[r] = sum / L(r, r);
+   }
+}
+
+bool SquareMatrix::solve(const Params& b, 
+              /*output*/ Params* x) const {
+   ASSERT( b.size() == N );
+   SquareMatrix L;
+   if (!cholesky(&L)) return false;
+   substitute(L, b, x);
+   return true;
+}
+
+// one factorisation, then one substitution per column of the identity
+bool SquareMatrix::inverse(SquareMatrix* inv) const {
+   SquareMatrix L;
+   if (!cholesky(&L)) return false;
+   *inv = SquareMatrix(N, 0.0);
+   Params column(N, 0.0), result;
+   for (size_t c = 0; c < N; c++) {
+      column.assign(N, 0.0);
+      column[c] = 1.0;
+      substitute(L, column, &result);
+      for (size_t r = 0; r < N; r++) (*inv)(r, c) = result[r];
+   }
+   return true;
+}
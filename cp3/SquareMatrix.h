@@ -0,0 +1,31 @@
+#ifndef SQUAREMATRIX_H
+#define SQUAREMATRIX_H
+
+#include <vector>
+#include "../global.h"
+
+// small dense square matrix, one row/column per fit parameter. Stored row-major in one block
+class SquareMatrix {
+public:
+   SquareMatrix(const size_t n = 0, const double init = 0.0) : N(n), elements(n*n, init) { }
+
+   static SquareMatrix identity(const size_t n);
+
+   size_t size() const                                   { return N; }
+   double& operator()(const size_t r, const size_t c)       { return elements[r*N + c]; }
+   double  operator()(const size_t r, const size_t c) const { return elements[r*N + c]; }
+
+   Params operator*(const Params& v) const;              // matrix-vector product
+
+   bool cholesky(SquareMatrix* L) const;                 // lower triangular L with L*L^T = this, false if not positive definite
+   bool solve(const Params& b, Params* x) const;         // x = this^-1 * b, for symmetric positive definite matrices
+   bool inverse(SquareMatrix* inv) const;                // same restriction as solve()
+
+   static void substitute(const SquareMatrix& L, const Params& b, Params* x); // solve L*L^T * x = b
+
+private:
+   size_t N;
+   std::vector<double> elements;
+};
+
+#endif
@@ -14,39 +14,14 @@
 #include "Minimiser.h"
 #include "DataPoints.h"
 #include "ModelFunctions.h"
+#include "LinearLeastSquares.h"
+#include "Objective.h"
+#include "MCMC.h"
 
 // MINUIT2
 #include "Math/IFunction.h"
 #include "Math/Functor.h"
 #include "Minuit2/Minuit2Minimizer.h"
-// global array of points from the data file, only used to access x/y values in chisq_2() for minuit
-DataPoints global_datapoints;
-
-// for Minimiser
-double chisq_1(const DataPoints& data, const Params& params, ModelFunction func) {
-   double chisq = 0.0;
-   for (size_t i = 0; i < data.x.size(); i++) {
-      double y_model = func(data.x[i], params);
-      double chi = (data.y[i] - y_model) / data.e[i];
-      chisq += chi * chi;
-   }
-   return chisq;
-}
-
-// for MINUIT2
-double chisq_2(const double* params) {
-   const double a = params[0];
-   const double b = params[1];
-
-   double chisq = 0.0;
-   for (size_t i = 0; i < global_datapoints.x.size(); i++) {
-      double y_model = a + b*global_datapoints.x[i];
-      double chi = (global_datapoints.y[i] - y_model) / global_datapoints.e[i];
-      chisq += chi * chi;
-   }
-   return chisq;
-}
-
 int main() {
    const double epsilon = 1e-9;
    const size_t max_iterations = 1e5;
@@ -56,11 +31,12 @@ int main() {
    const DataPoints file_data(filename, "Data");   // read in data from file
 
    Minimiser m(file_data);                         // initialise a Minimiser engine
-   m.set_function_to_minimise(chisq_1);            // function that we're minimising by fitting the parameters
-   m.set_model_function(linear);                   // function that we're fitting the data to
+   m.set_model<Linear>();                          // function that we're fitting the data to, its derivatives and chisq
    m.set_epsilon(epsilon);                         // minimum acceptable error in minimise()
    m.set_max_iterations(max_iterations);           // limit the iteration count
    m.set_initial_grid_search_volumes(1e2);         // how many grid volumes to check along each param axis
+   m.set_method(LEVENBERG_MARQUARDT);              // how to home in on the minimum after the grid search
+   m.set_error_method(PARAMETER_SCAN);             // find errors along each param axis and plot them
 
    const Params upper = { 1.1,  0.1 };
    const Params lower = { 0.9, -0.1 };
@@ -79,9 +55,48 @@ int main() {
 
 
 
+   printf("-------------------STARTING CLOSED FORM LEAST SQUARES---------------\n");
+   // a straight line is linear in its parameters, so chisq can be minimised exactly in one pass
+   Params exact_params;
+   SquareMatrix covariance;
+   double exact_chisq;
+   ASSERT( linear_least_squares<Linear>(file_data, &exact_params, &covariance, &exact_chisq) );
+   for (size_t i = 0; i < exact_params.size(); i++) {
+      printf("\t%c = %s%f +- %f\n", (char)('a'+i), (exact_params[i]<0?"":" "), exact_params[i], 
+                                      sqrt(covariance(i,i)));
+   }
+   printf("Covariance(a,b) = %e\n", covariance(0,1));
+   printf("Minimum chisq = %f\n", exact_chisq);
+   printf("--------------------ENDING CLOSED FORM LEAST SQUARES----------------\n\n\n\n");
+
+
+
+   printf("----------------------STARTING MCMC SAMPLING------------------------\n");
+   // posterior of the fitted params, walkers starting in a small ball around the minimum
+   EnsembleSampler sampler(m, 32);
+   sampler.initialise(final_params, { 1e-3, 1e-3 });
+   sampler.run(500);                               // burn in, nothing saved
+   const std::string chain_filename = filename + ".chain"; // next to the data, like its cache
+   sampler.run(5000, chain_filename);              // streamed to disk as it goes
+
+   std::vector<double> samples;
+   size_t N_params, N_walkers;
+   ASSERT( EnsembleSampler::read_chain(chain_filename, &samples, &N_params, &N_walkers) );
+   remove(chain_filename.c_str());
+   const size_t N_samples = samples.size() / (N_params+1);
+   for (size_t i = 0; i < N_params; i++) {
+      double mean = 0.0, variance = 0.0;
+      for (size_t s = 0; s < N_samples; s++) mean += samples[s*(N_params+1) + i] / N_samples;
+      for (size_t s = 0; s < N_samples; s++) variance += pow(samples[s*(N_params+1) + i] - mean, 2) / N_samples;
+      printf("\t%c = %s%f +- %f\n", (char)('a'+i), (mean<0?"":" "), mean, sqrt(variance));
+   }
+   printf("Acceptance fraction = %f\n", sampler.acceptance_fraction());
+   printf("-----------------------ENDING MCMC SAMPLING-------------------------\n\n\n\n");
+
+
+
 #ifndef NO_MINUIT_INSTALLED
    printf("-------------------STARTING MINUIT2 MINIMISATION--------------------\n");
-   global_datapoints = file_data; // accessed in chisq_2()
    ROOT::Math::Minimizer* min = new ROOT::Minuit2::Minuit2Minimizer("minimize");
 
    // minimiser settings
@@ -89,7 +104,8 @@ int main() {
    min->SetTolerance(epsilon);
    min->SetPrintLevel(1); // increase this to print out more verbose results
 
-   ROOT::Math::Functor function(&chisq_2, 2); // 2 parameters
+   ModelObjective<Linear> chisq(file_data);     // chisq of a straight line, carrying its own reference to the data
+   ROOT::Math::Functor function(chisq, chisq.size());
    min->SetFunction(function);
 
    double variable[] = { 1.0,  0.0 };  // starting point
@@ -0,0 +1,79 @@
+#include <thread>
+#include <chrono>
+
+#include "../global.h"
+#include "Image.h"
+#include "Row.h"
+#include "Batch.h"
+
+Batch::Batch(const std::vector<std::string>& inputs,
+             const std::string& directory,
+             const size_t iterations,
+             const size_t n_workers)
+         : files(inputs),
+           output_dir(directory),
+           iteration_limit(iterations),
+           workers(n_workers),
+           next_file(0),
+           finished_files(0),
+           total_rows(0) {
+   ASSERT( iteration_limit >= 1 );
+   ASSERT( workers >= 1 );
+}
+
+void Batch::run() {
+   const size_t N_threads = MIN( workers, files.size() );
+   printf("Images  = %zu\n", files.size());
+   printf("Workers = %zu\n", N_threads);
+   printf("Output  = %s\n\n", (output_dir.empty() ? "alongside inputs" : output_dir.c_str()));
+
+   const auto start = std::chrono::steady_clock::now();
+   std::vector<std::thread> pool;
+   for (size_t i = 0; i < N_threads; i++) {
+      pool.push_back(std::thread(&Batch::worker, this));
+   }
+   for (auto& t : pool) t.join();
+   const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   printf("\nSynchronised %zu images in %.2f s (%.1f images/s, %.0f rows/s)\n", 
+          finished_files, seconds, finished_files/seconds, total_rows/seconds);
+}
+
+/* keep claiming files until there are none left */
+void Batch::worker() {
+   while (true) {
+      size_t index;
+      {
+         std::lock_guard<std::mutex> guard(lock);
+         if (next_file >= files.size()) return;
+         index = next_file++;
+      }
+      process(index);
+   }
+}
+
+void Batch::process(const size_t index) {
+   Image img(files[index], false);
+   img.quiet = true;
+
+   size_t iterations = 0;
+   while (iterations < iteration_limit) {
+      iterations++;
+      if ( img.synchronise() == false ) 
+         break;
+   }
+   img.save(output_dir);
+
+   size_t shifted = 0;
+   for (size_t r = 0; r < img.height; r++) {
+      if (img.rows[r].displacement() != 0) shifted++;
+   }
+
+   std::lock_guard<std::mutex> guard(lock);
+   finished_files++;
+   total_rows += img.height;
+   printf("[%*zu/%zu] %s -> %s (%zu iterations, %zu/%zu rows shifted)\n", 
+          (int)std::to_string(files.size()).size(), finished_files, files.size(),
+          files[index].c_str(), img.output_filename(output_dir).c_str(),
+          iterations, shifted, img.height);
+}
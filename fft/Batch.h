@@ -0,0 +1,39 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+/*
+   Synchronises a whole list of images in one process. A fixed pool of worker
+   threads pulls the next unclaimed filename off the list until it's empty, 
+   so at most one Image per worker is held in memory at any time. Each Image
+   is run quietly and a single summary line is printed as each one finishes.
+*/
+class Batch {
+public:
+   std::vector<std::string> files;      // input pgm files
+   std::string              output_dir; // empty = write next to each input
+   size_t                   iteration_limit;
+   size_t                   workers;
+
+public:
+   Batch(const std::vector<std::string>& inputs, 
+         const std::string& directory,
+         const size_t iterations,
+         const size_t n_workers);
+
+   void run();
+
+private:
+   size_t     next_file;      // index of the next file to be claimed
+   size_t     finished_files; // number of files completed so far
+   size_t     total_rows;     // rows across all finished images
+   std::mutex lock;           // guards the three counters above and stdout
+
+   void worker();
+   void process(const size_t index);
+};
+
+#endif
@@ -12,7 +12,9 @@
 Image::Image(const std::string& file,
              const bool is_debug)
          : filename(file), 
-           print_debug(is_debug) {
+           print_debug(is_debug),
+           phase_correlation(false),
+           quiet(false) {
    /* check that image filename is valid */ 
    const size_t pos = filename.find_last_of(".");
    std::string extension = filename.substr(pos+1);
@@ -52,10 +54,35 @@ Image::Image(const std::string& file,
       this->rows[r].initialise(this, r);
    }
    delete[] this->pixels; /* we don't need this anymore */
+
+   /* no overlap between two rows can be wider than the image itself */
+   this->spectrum1 = Row::allocate(this->width);
+   this->spectrum2 = Row::allocate(this->width);
 }
 
 Image::~Image() {
    delete[] this->rows;
+   std::lock_guard<std::mutex> lock(Row::planner_mutex());
+   for (auto& p : forward_plans)  fftw_destroy_plan(p.second);
+   for (auto& p : backward_plans) fftw_destroy_plan(p.second);
+   Row::deallocate(spectrum1);
+   Row::deallocate(spectrum2);
+}
+
+/* plans are made once per transform length and then reused with 
+   fftw_execute_dft() on whichever arrays we want. FFTW_UNALIGNED lets us 
+   transform straight out of a Row's pixel array at any offset */
+fftw_plan Image::plan(const size_t length, 
+                      const int direction) {
+   std::map<size_t, fftw_plan>& plans = (direction == FFTW_FORWARD) ? forward_plans 
+                                                                     : backward_plans;
+   auto it = plans.find(length);
+   if (it != plans.end()) return it->second;
+   std::lock_guard<std::mutex> lock(Row::planner_mutex());
+   fftw_plan p = fftw_plan_dft_1d(length, spectrum2, spectrum1, direction, 
+                                  FFTW_ESTIMATE | FFTW_UNALIGNED);
+   plans[length] = p;
+   return p;
 }
 
 /* These are the rules I put together to decide whether a row needs to be 
@@ -174,7 +201,7 @@ bool Image::synchronise() {
       for (auto r : rows_to_be_shifted) 
          printf("%zu ", r);
       printf("\n");
-   } else {
+   } else if (!quiet) {
       printf("%4zu/%zu rows shifted\n", rows_to_be_shifted.size(), height);
    }
 
@@ -201,37 +228,40 @@ bool Image::synchronise() {
 
 /* calculate the x-coordinate of the max value of the cross correlation */
 int Image::peak(const Row& r) const {
-   double max_height = -1e200;
-   int peak_position;
-   std::vector<double> x(r.width);
-   for (size_t i = 0; i < x.size(); i++) {
-      /* fudge factor at the end is to account for some problems I ran into */
-      x[i] = i - 0.5*r.width + (r.width%2==1?0.5:0); 
-   }
-   for (size_t i = 0; i < r.width; i++) {
-      /* magnitude(i) is the magnitude of the complex number at the ith column */
-      if (r.magnitude(i) > max_height) {
-         max_height = r.pixels[i][0];
-         peak_position = ROUND( x[i] );
-      }
-   }
-   return peak_position;
+   const size_t i = Row::argmax_magnitude(r.pixels, r.width);
+   /* fudge factor at the end is to account for some problems I ran into */
+   const double x = i - 0.5*r.width + (r.width%2==1?0.5:0);
+   return ROUND( x );
 }
 
+/* transforms the overlapping stretch of each row directly out of its pixel 
+   array, builds the cross-power spectrum in place in spectrum1 and inverts it
+   into the returned Row, so the only allocation per pair is the result */
 Row Image::cross_correlate(const Row& row1, 
                            const Row& row2) {
    /* get the largest stretch of pixels thats covered by both row1 and row2 */
    const size_t first_index  = MAX( row1.starting_index, row2.starting_index );
    const size_t subrow_width = row1.overlapping_pixels_with(row2);
-   const Row r1 = row1.subrow(first_index, subrow_width);
-   const Row r2 = row2.subrow(first_index, subrow_width);
+   ASSERT( subrow_width > 0 );
+   ASSERT( first_index < row1.starting_index + row1.width );
+   ASSERT( first_index < row2.starting_index + row2.width );
 
-   ASSERT( r1.width == r2.width );
+   fftw_complex* in1 = row1.pixels + (first_index - row1.starting_index);
+   fftw_complex* in2 = row2.pixels + (first_index - row2.starting_index);
+   const fftw_plan forward = plan(subrow_width, FFTW_FORWARD);
+   fftw_execute_dft(forward, in1, spectrum1);
+   fftw_execute_dft(forward, in2, spectrum2);
 
-   const Row fft1       = r1.fft();
-   const Row fft2       = r2.fft();
-   const Row multiplied = fft1 * fft2.conjugate();
-   Row inversed         = multiplied.inverse_fft();
+   Row::cross_power_spectrum(spectrum1, spectrum2, spectrum1, subrow_width, 
+                             phase_correlation);
+
+   Row inversed;
+   inversed.parent         = row1.parent;
+   inversed.width          = subrow_width;
+   inversed.row_index      = row1.row_index;
+   inversed.starting_index = first_index;
+   inversed.pixels         = Row::allocate(subrow_width);
+   fftw_execute_dft(plan(subrow_width, FFTW_BACKWARD), spectrum1, inversed.pixels);
 
    /* shift the phase of the periodic function, so the peak is (ideally) at 
       the middle of the curve */
@@ -249,11 +279,9 @@ Row Image::cross_correlate(const Row& row1,
    | A | A | A | A | B | C | D | E | F | F |
    -----------------------------------------
 */
-void Image::save() const {
-   const size_t pos_extension     = filename.find_last_of(".");
-   const std::string no_extension = filename.substr(0, pos_extension);
-   const std::string output_name  = no_extension + "_synced.pgm";
-   std::ofstream file(output_name);
+void Image::save(const std::string& output_dir) const {
+   const std::string output_name = output_filename(output_dir);
+   std::ofstream file(output_name, std::ios::binary);
    ASSERT( file.is_open() );
 
    /* file info at the top */
@@ -264,19 +292,31 @@ void Image::save() const {
    file << "# " << base_filename << " after resynchronisation\n"; 
    file << width << " " << height << " 255\n";
 
+   /* each output line is built in one buffer and written in one go */
+   std::vector<unsigned char> line(width);
    for (size_t r = 0; r < height; r++) {
-      const Row R = rows[r];
+      const Row& R = rows[r];
       const size_t start_r = R.starting_index;
       const size_t width_r = R.width;
-      size_t j = 0;
-      for (size_t c = 0; c < width; c++) {
-         double temp;
-         if      (c < start_r)         temp = R.pixels[0][0];
-         else if (c < start_r+width_r) temp = R.magnitude(j++);
-         else                          temp = R.pixels[width_r-1][0];
-         file << (unsigned char)temp;
-      }
+      const unsigned char first = (unsigned char)R.pixels[0][0];
+      const unsigned char last  = (unsigned char)R.pixels[width_r-1][0];
+      for (size_t c = 0; c < start_r; c++)               line[c] = first;
+      Row::magnitudes_to_bytes(R.pixels, &line[start_r], width_r);
+      for (size_t c = start_r+width_r; c < width; c++)   line[c] = last;
+      file.write((const char*)line.data(), width);
    }
    file.close();
-   printf("Saved to %s\n", output_name.c_str());
+   if (!quiet) printf("Saved to %s\n", output_name.c_str());
+}
+
+/* images/desync1.pgm -> images/desync1_synced.pgm, or output_dir/desync1_synced.pgm
+   if an output directory is given */
+std::string Image::output_filename(const std::string& output_dir) const {
+   const size_t pos_extension     = filename.find_last_of(".");
+   const std::string no_extension = filename.substr(0, pos_extension);
+   if (output_dir.empty()) return no_extension + "_synced.pgm";
+
+   const size_t pos_filename      = no_extension.find_last_of("/");
+   const std::string base_name    = no_extension.substr(pos_filename+1);
+   return output_dir + "/" + base_name + "_synced.pgm";
 }
\ No newline at end of file
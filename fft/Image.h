@@ -2,6 +2,7 @@
 #define Image_H
 
 #include <string>
+#include <map>
 #include "../global.h"
 
 class Row;
@@ -15,16 +16,28 @@ public:
    Row*        rows;     // array of pixel rows
 
    bool        print_debug; // decides whether or not to print loads of info
+   bool        phase_correlation; // normalise the cross-power spectrum
+   bool        quiet;       // no console output at all, for batch runs
+
+   /* FFT workspace reused by every cross_correlate() call, sized to width */
+   fftw_complex* spectrum1;
+   fftw_complex* spectrum2;
+   std::map<size_t, fftw_plan> forward_plans;  // keyed by transform length
+   std::map<size_t, fftw_plan> backward_plans;
 
 public:
    Image(const std::string& file, const bool is_debug);
    ~Image();
    
    bool synchronise();
-   void save() const;
+   void save(const std::string& output_dir="") const;
+   std::string output_filename(const std::string& output_dir="") const;
    Row cross_correlate(const Row& row1, const Row& row2);
    int peak(const Row& r) const;
    bool row_should_be_shifted(const size_t r, const std::vector<int>& peaks);
+
+private:
+   fftw_plan plan(const size_t length, const int direction);
 };
 
 #endif
\ No newline at end of file
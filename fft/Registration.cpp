@@ -0,0 +1,99 @@
+#include <math.h>
+#include <string.h>
+#include <mutex>
+
+#include "../global.h"
+#include "Row.h"
+#include "Registration.h"
+
+/* fftw_init_threads() must be called once before any multithreaded plan */
+static void init_fftw_threads() {
+   static std::once_flag flag;
+   std::call_once(flag, [] { ASSERT( fftw_init_threads() != 0 ); });
+}
+
+Registration::Registration(const size_t w,
+                           const size_t h,
+                           const int n_threads)
+         : width(w),
+           height(h),
+           threads(n_threads),
+           has_reference(false) {
+   ASSERT( width > 1 && height > 1 );
+   ASSERT( threads >= 1 );
+   real_buffer        = (double*)fftw_malloc(sizeof(double) * width * height);
+   reference_spectrum = Row::allocate(spectrum_size());
+   spectrum           = Row::allocate(spectrum_size());
+
+   /* these plans get reused for every frame, so it's worth letting FFTW 
+      measure a few algorithms rather than just estimating */
+   std::lock_guard<std::mutex> lock(Row::planner_mutex());
+   init_fftw_threads();
+   fftw_plan_with_nthreads(threads);
+   forward  = fftw_plan_dft_r2c_2d(height, width, real_buffer, spectrum, FFTW_MEASURE);
+   backward = fftw_plan_dft_c2r_2d(height, width, spectrum, real_buffer, FFTW_MEASURE);
+   fftw_plan_with_nthreads(1);
+}
+
+Registration::~Registration() {
+   std::lock_guard<std::mutex> lock(Row::planner_mutex());
+   fftw_destroy_plan(forward);
+   fftw_destroy_plan(backward);
+   fftw_free(real_buffer);
+   Row::deallocate(reference_spectrum);
+   Row::deallocate(spectrum);
+}
+
+/* planning with FFTW_MEASURE scribbles over the buffers, so frames are always
+   copied in here rather than planned on directly */
+void Registration::transform(const double* frame,
+                             fftw_complex* output) {
+   memcpy(real_buffer, frame, sizeof(double) * width * height);
+   fftw_execute_dft_r2c(forward, real_buffer, output);
+}
+
+void Registration::set_reference(const double* frame) {
+   transform(frame, reference_spectrum);
+   has_reference = true;
+}
+
+FrameShift Registration::register_frame(const double* frame) {
+   ASSERT( has_reference );
+   transform(frame, spectrum);
+   /* same kernel as the row cross-correlation, normalised so that only the 
+      phase difference between the two frames survives */
+   Row::cross_power_spectrum(spectrum, reference_spectrum, spectrum, 
+                             spectrum_size(), true);
+   fftw_execute(backward);
+   return find_peak();
+}
+
+/* the correlation surface is periodic, so anything past the halfway point in 
+   either direction is really a negative shift. The integer peak is refined 
+   with a parabola through it and its neighbours along each axis */
+FrameShift Registration::find_peak() const {
+   const size_t N = width * height;
+   size_t best = 0;
+   for (size_t i = 1; i < N; i++) {
+      if (real_buffer[i] > real_buffer[best]) best = i;
+   }
+   const size_t x = best % width;
+   const size_t y = best / width;
+
+   const double centre = real_buffer[best];
+   const double left   = real_buffer[y*width + (x+width-1) % width];
+   const double right  = real_buffer[y*width + (x+1) % width];
+   const double up     = real_buffer[((y+height-1) % height)*width + x];
+   const double down   = real_buffer[((y+1) % height)*width + x];
+   const double denom_x = left - 2*centre + right;
+   const double denom_y = up   - 2*centre + down;
+
+   FrameShift result;
+   result.dx = (x > width/2)  ? (double)x - width  : (double)x;
+   result.dy = (y > height/2) ? (double)y - height : (double)y;
+   if (denom_x < 0.0) result.dx += 0.5 * (left - right) / denom_x;
+   if (denom_y < 0.0) result.dy += 0.5 * (up - down)    / denom_y;
+   /* c2r is unnormalised, so a perfect match peaks at width*height */
+   result.confidence = centre / (double)N;
+   return result;
+}
@@ -0,0 +1,59 @@
+#ifndef REGISTRATION_H
+#define REGISTRATION_H
+
+#include "../global.h"
+
+/* translation of one frame relative to the reference, in pixels. Positive dx
+   means the frame's content sits to the right of the reference, positive dy 
+   means it sits further down. confidence is the height of the normalised 
+   phase correlation peak, 1 for a perfect match and near 0 for no match */
+struct FrameShift {
+   double dx;
+   double dy;
+   double confidence;
+};
+
+/*
+   Whole-frame registration by 2D phase correlation, for lining up frames from
+   a video stream against a fixed reference frame. All frames have to be the
+   same size, given to the constructor along with the number of threads FFTW 
+   is allowed to use for each transform.
+
+   Frames are real, so the forward transform is r2c and only the 
+   width/2+1 non-redundant columns of each spectrum are stored. The plans and 
+   buffers are built once in the constructor and reused for every frame, and 
+   the reference spectrum is kept so each new frame costs one forward 
+   transform, one spectrum product and one inverse transform.
+
+   Frames are passed as row-major arrays of width*height pixel values.
+*/
+class Registration {
+public:
+   size_t width;   // number of columns in each frame
+   size_t height;  // number of rows in each frame
+   int    threads; // FFTW threads per transform
+
+public:
+   Registration(const size_t w, const size_t h, const int n_threads=1);
+   ~Registration();
+
+   void set_reference(const double* frame);
+   FrameShift register_frame(const double* frame);
+
+private:
+   double*       real_buffer;        // width*height real pixels or correlation
+   fftw_complex* reference_spectrum; // height*(width/2+1)
+   fftw_complex* spectrum;           // height*(width/2+1)
+   fftw_plan     forward;            // r2c, real_buffer -> spectrum
+   fftw_plan     backward;           // c2r, spectrum -> real_buffer
+   bool          has_reference;
+
+   size_t spectrum_size() const { return height * (width/2 + 1); }
+   void transform(const double* frame, fftw_complex* output);
+   FrameShift find_peak() const;
+
+   Registration(const Registration&);            // plans and buffers are owned,
+   Registration& operator=(const Registration&); // so no copying
+};
+
+#endif
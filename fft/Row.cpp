@@ -100,6 +100,7 @@ void Row::recentre() {
    efficient way of doing things, but efficiency wasn't what I was aiming for */
 Row Row::fft() const {
    Row result(*this);
+   std::lock_guard<std::mutex> lock(planner_mutex());
    fftw_plan p = fftw_plan_dft_1d(width, this->pixels, result.pixels, FFTW_FORWARD, FFTW_ESTIMATE);
    fftw_execute(p);
    fftw_destroy_plan(p);
@@ -108,6 +109,7 @@ Row Row::fft() const {
 
 Row Row::inverse_fft() const {
    Row result(*this);
+   std::lock_guard<std::mutex> lock(planner_mutex());
    fftw_plan p = fftw_plan_dft_1d(width, this->pixels, result.pixels, FFTW_BACKWARD, FFTW_ESTIMATE);
    fftw_execute(p);
    fftw_destroy_plan(p);
@@ -160,6 +162,118 @@ double Row::magnitude(const size_t index) const {
                pixels[index][1]*pixels[index][1]);
 }
 
+/* fused version of a * b.conjugate(), writing the cross-power spectrum straight
+   into out without building any temporary Row objects. out is allowed to be 
+   the same array as a, so the product can be built in place in an FFT buffer.
+   If normalise is true each element is divided by its own magnitude, which 
+   turns the cross-correlation into a phase correlation (a much sharper peak 
+   that doesn't care about the brightness of either row). The loop is kept 
+   branch-free so the compiler can vectorise it */
+void Row::cross_power_spectrum(const fftw_complex* a,
+                               const fftw_complex* b,
+                               fftw_complex* out,
+                               const size_t size,
+                               const bool normalise) {
+   const double* A = &a[0][0];
+   const double* B = &b[0][0];
+   double* O = &out[0][0];
+   if (normalise) {
+      for (size_t i = 0; i < size; i++) {
+         /* (P + iQ)(R - iS) = (PR+QS) + i(QR-PS) */
+         const double P = A[2*i], Q = A[2*i+1];
+         const double R = B[2*i], S = B[2*i+1];
+         const double re  = P*R + Q*S;
+         const double im  = Q*R - P*S;
+         const double mag = sqrt(re*re + im*im);
+         const double scale = (mag > 0.0) ? 1.0/mag : 0.0;
+         O[2*i]   = re * scale;
+         O[2*i+1] = im * scale;
+      }
+   } else {
+      for (size_t i = 0; i < size; i++) {
+         const double P = A[2*i], Q = A[2*i+1];
+         const double R = B[2*i], S = B[2*i+1];
+         O[2*i]   = P*R + Q*S;
+         O[2*i+1] = Q*R - P*S;
+      }
+   }
+}
+
+/* index of the element with the largest magnitude, comparing squared 
+   magnitudes so no sqrt is needed. Each of the LANES running maxima only sees
+   every LANES'th element, which lets the compiler turn the inner loop into 
+   vector compares and blends. Ties go to the lowest index, same as a plain 
+   scalar search would give */
+size_t Row::argmax_magnitude(const fftw_complex* a, 
+                             const size_t size) {
+   ASSERT( size > 0 );
+   const double* A = &a[0][0];
+   enum { LANES = 4 };
+   double best[LANES];
+   size_t index[LANES];
+   for (size_t l = 0; l < LANES; l++) {
+      best[l]  = -1.0;
+      index[l] = 0;
+   }
+
+   const size_t bulk = size - size % LANES;
+   for (size_t i = 0; i < bulk; i += LANES) {
+      for (size_t l = 0; l < LANES; l++) {
+         const double re  = A[2*(i+l)];
+         const double im  = A[2*(i+l)+1];
+         const double mag = re*re + im*im;
+         const bool bigger = mag > best[l];
+         best[l]  = bigger ? mag   : best[l];
+         index[l] = bigger ? i + l : index[l];
+      }
+   }
+
+   /* reduce the lanes, then finish off the leftover elements */
+   double max_mag = best[0];
+   size_t max_index = index[0];
+   for (size_t l = 1; l < LANES; l++) {
+      if (best[l] > max_mag || (best[l] == max_mag && index[l] < max_index)) {
+         max_mag   = best[l];
+         max_index = index[l];
+      }
+   }
+   for (size_t i = bulk; i < size; i++) {
+      const double mag = A[2*i]*A[2*i] + A[2*i+1]*A[2*i+1];
+      if (mag > max_mag) {
+         max_mag   = mag;
+         max_index = i;
+      }
+   }
+   return max_index;
+}
+
+/* bulk version of (unsigned char)magnitude(i) for every element, clamped to 
+   the 0-255 range of a pgm pixel */
+void Row::magnitudes_to_bytes(const fftw_complex* a, 
+                              unsigned char* out, 
+                              const size_t size) {
+   const double* A = &a[0][0];
+   for (size_t i = 0; i < size; i++) {
+      const double mag = sqrt(A[2*i]*A[2*i] + A[2*i+1]*A[2*i+1]);
+      out[i] = (unsigned char)(mag < 255.0 ? mag : 255.0);
+   }
+}
+
+/* how far the row's content has been moved by shift(), positive to the right.
+   A right shift leaves a gap at the start (starting_index > 0), a left shift 
+   leaves the row starting at 0 but narrower than the parent image */
+int Row::displacement() const {
+   if (starting_index > 0) return (int)starting_index;
+   return -(int)(parent->width - width);
+}
+
+/* only fftw_execute*() is thread safe, so anything that creates or destroys a 
+   plan has to hold this while it does */
+std::mutex& Row::planner_mutex() {
+   static std::mutex m;
+   return m;
+}
+
 /* so we don't have loads of ugly pointer casts littered all over the place */
 fftw_complex* Row::allocate(const size_t size) {
    fftw_complex* output = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * size);
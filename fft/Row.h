@@ -2,6 +2,7 @@
 #define ROW_H
 
 #include <fftw3.h>
+#include <mutex>
 class Image;
 
 /*
@@ -54,8 +55,19 @@ public:
    Row inverse_fft() const;
    Row subrow(const size_t first, const size_t length) const;
    double magnitude(const size_t index) const;
+   int displacement() const;
    size_t overlapping_pixels_with(const Row& r) const;
    
+   static void cross_power_spectrum(const fftw_complex* a,
+                                    const fftw_complex* b,
+                                    fftw_complex* out,
+                                    const size_t size,
+                                    const bool normalise);
+   static size_t argmax_magnitude(const fftw_complex* a, const size_t size);
+   static void magnitudes_to_bytes(const fftw_complex* a, 
+                                   unsigned char* out, 
+                                   const size_t size);
+   static std::mutex& planner_mutex();
    static fftw_complex* allocate(const size_t size);
    static void deallocate(const Row& r);
    static void deallocate(fftw_complex* a);
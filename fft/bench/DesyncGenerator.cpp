@@ -0,0 +1,127 @@
+#include <math.h>
+#include <fstream>
+
+#include "../../global.h"
+#include "DesyncGenerator.h"
+
+DesyncGenerator::DesyncGenerator(const size_t w, 
+                                 const size_t h, 
+                                 const unsigned s) 
+         : width(w), 
+           height(h), 
+           max_shift(w/20 > 1 ? w/20 : 1), 
+           max_block(3),
+           shifted_fraction(0.08), 
+           noise(2.0), 
+           seed(s) { }
+
+/* smooth background made from a load of overlapping gaussian blobs, so that 
+   neighbouring rows look alike (which is what the cross-correlation relies on)
+   but there's still plenty of horizontal structure to lock on to */
+std::vector<double> DesyncGenerator::base_image(std::mt19937& rng) const {
+   std::vector<double> img(width*height, 128.0);
+   std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+   const size_t N_blobs = 1 + width*height/1500;
+   for (size_t b = 0; b < N_blobs; b++) {
+      const double cx     = uniform(rng) * width;
+      const double cy     = uniform(rng) * height;
+      const double radius = 3.0 + 37.0*uniform(rng);
+      const double height_b = (uniform(rng) < 0.5 ? -1 : 1) * (20.0 + 60.0*uniform(rng));
+
+      /* only bother with pixels within 3 sigma of the centre */
+      const int x0 = MAX( 0, (int)(cx - 3*radius) );
+      const int x1 = MIN( (int)width,  (int)(cx + 3*radius) );
+      const int y0 = MAX( 0, (int)(cy - 3*radius) );
+      const int y1 = MIN( (int)height, (int)(cy + 3*radius) );
+      for (int y = y0; y < y1; y++) {
+         for (int x = x0; x < x1; x++) {
+            const double r2 = (x-cx)*(x-cx) + (y-cy)*(y-cy);
+            img[y*width + x] += height_b * exp( -0.5 * r2/(radius*radius) );
+         }
+      }
+   }
+   return img;
+}
+
+/* rows are desynced in blocks of 1 to max_block rows, each block sharing one 
+   nonzero shift, with at least one untouched row between blocks. The syncer 
+   gives up on anything more than a tenth of the row width, so stay below it */
+void DesyncGenerator::choose_shifts(std::mt19937& rng) {
+   shifts.assign(height, 0);
+   std::uniform_real_distribution<double> uniform(0.0, 1.0);
+   std::uniform_int_distribution<int>     distance(1, max_shift);
+   std::uniform_int_distribution<size_t>  block(1, max_block);
+
+   for (size_t r = 1; r < height; r++) {
+      if (uniform(rng) >= shifted_fraction) continue;
+      const int s = (uniform(rng) < 0.5 ? -1 : 1) * distance(rng);
+      const size_t length = block(rng);
+      for (size_t i = 0; i < length && r < height-1; i++, r++) {
+         shifts[r] = s;
+      }
+   }
+}
+
+/* writes a P5 pgm with the same 4 line header that Image() expects */
+void DesyncGenerator::generate(const std::string& filename) {
+   ASSERT( width > 0 && height > 0 );
+   ASSERT( max_shift >= 1 );
+   std::mt19937 rng(seed);
+   background = base_image(rng);
+   choose_shifts(rng);
+   std::normal_distribution<double> gauss(0.0, noise > 0.0 ? noise : 1.0);
+
+   std::ofstream file(filename, std::ios::binary);
+   ASSERT( file.is_open() );
+   file << "P5\n";
+   file << "# Title:\n";
+   file << "# synthetic desync, seed " << seed << "\n";
+   file << width << " " << height << " 255\n";
+
+   std::vector<unsigned char> line(width);
+   for (size_t r = 0; r < height; r++) {
+      for (size_t c = 0; c < width; c++) {
+         /* content moves right by shifts[r], wrapping around the edges */
+         const long source = ((long)c - shifts[r]) % (long)width;
+         double value = background[r*width + (source < 0 ? source + width : source)];
+         if (noise > 0.0) value += gauss(rng);
+         value = (value < 0.0) ? 0.0 : (value > 255.0 ? 255.0 : value);
+         line[c] = (unsigned char)(value + 0.5);
+      }
+      file.write((const char*)line.data(), width);
+   }
+   file.close();
+}
+
+/* one shift per line, in row order */
+void DesyncGenerator::save_shifts(const std::string& filename) const {
+   std::ofstream file(filename);
+   ASSERT( file.is_open() );
+   for (const int s : shifts) file << s << '\n';
+   file.close();
+}
+
+/* the background moved dx pixels right and dy pixels down as a whole, 
+   wrapping around at the edges, with its own noise. Row-major, as 
+   Registration takes it. generate() has to have been called first */
+std::vector<double> DesyncGenerator::frame(const int dx, 
+                                           const int dy, 
+                                           const unsigned frame_seed) const {
+   ASSERT( background.size() == width*height );
+   std::mt19937 rng(frame_seed);
+   std::normal_distribution<double> gauss(0.0, noise > 0.0 ? noise : 1.0);
+   std::vector<double> output(width*height);
+   for (size_t r = 0; r < height; r++) {
+      long source_r = ((long)r - dy) % (long)height;
+      if (source_r < 0) source_r += height;
+      for (size_t c = 0; c < width; c++) {
+         long source_c = ((long)c - dx) % (long)width;
+         if (source_c < 0) source_c += width;
+         double value = background[source_r*width + source_c];
+         if (noise > 0.0) value += gauss(rng);
+         output[r*width + c] = value;
+      }
+   }
+   return output;
+}
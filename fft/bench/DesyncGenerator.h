@@ -0,0 +1,45 @@
+#ifndef DESYNCGENERATOR_H
+#define DESYNCGENERATOR_H
+
+#include <string>
+#include <vector>
+#include <random>
+
+/*
+   Builds synthetic greyscale images of any size in the same PGM layout as the
+   ones in fft/images, with a known horizontal shift applied to some of the 
+   rows. The shifts are kept in this->shifts (and written out next to the 
+   image) so the output of Image::synchronise() can be checked against them.
+
+   A shift of +s means the content of that row has been moved s pixels to the
+   right, wrapping around at the edges, so the syncer should apply -s to it.
+
+   frame() moves the whole unshifted image instead, by a known (dx, dy), for 
+   checking Registration against.
+*/
+class DesyncGenerator {
+public:
+   size_t   width;            // number of columns
+   size_t   height;           // number of rows
+   int      max_shift;        // largest |shift| given to a desynced row
+   size_t   max_block;        // longest run of adjacent rows sharing one shift
+   double   shifted_fraction; // chance of any row starting a shifted block
+   double   noise;            // sigma of the gaussian noise added to every pixel
+   unsigned seed;             // same seed = same image and same shifts
+
+   std::vector<int> shifts;   // ground truth, one entry per row
+   std::vector<double> background; // the image before any shifts or noise, from generate()
+
+public:
+   DesyncGenerator(const size_t w, const size_t h, const unsigned s);
+
+   void generate(const std::string& filename);
+   void save_shifts(const std::string& filename) const;
+   std::vector<double> frame(const int dx, const int dy, const unsigned frame_seed) const;
+
+private:
+   std::vector<double> base_image(std::mt19937& rng) const;
+   void choose_shifts(std::mt19937& rng);
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include <chrono>
+#include <algorithm>
+#include <math.h>
+
+#include "../../global.h"
+#include "../Image.h"
+#include "../Row.h"
+#include "../Registration.h"
+#include "DesyncGenerator.h"
+
+/*
+
+   Run as:
+      ./fft_bench <width> <height> <iteration_limit> <seed>
+
+   Generates a synthetic desynchronised image of the given size with known 
+   per-row shifts, then times every stage of the resynchronisation:
+      load      = Image() constructor, reading the pgm into Row objects
+      correlate = one pass of cross_correlate() + peak() over every row pair
+      sync      = the full Image::synchronise() loop up to iteration_limit
+      save      = Image::save()
+      register  = Registration::register_frame() for each of a set of whole 
+                  frames, moved by known random (dx, dy) from an unshifted 
+                  reference frame
+   and compares the shifts that were applied against the ground truth.
+   Defaults are 1024 x 1024, 20 iterations, seed 1.
+
+*/
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(const Clock::time_point& start) {
+   return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static size_t argument(int argc, char** argv, const int i, const size_t fallback) {
+   if (argc <= i) return fallback;
+   ASSERT( isdigit(argv[i][0]) );
+   const int value = atoi(argv[i]);
+   ASSERT( value >= 1 );
+   return value;
+}
+
+int main(int argc, char** argv) {
+   const size_t width           = argument(argc, argv, 1, 1024);
+   const size_t height          = argument(argc, argv, 2, 1024);
+   const size_t iteration_limit = argument(argc, argv, 3, 20);
+   const unsigned seed          = argument(argc, argv, 4, 1);
+
+   const std::string filename = "fft/images/synthetic.pgm";
+   DesyncGenerator generator(width, height, seed);
+   Clock::time_point start = Clock::now();
+   generator.generate(filename);
+   generator.save_shifts("fft/images/synthetic_shifts.txt");
+   const double t_generate = seconds_since(start);
+   const size_t N_desynced = height - std::count(generator.shifts.begin(), 
+                                                  generator.shifts.end(), 0);
+   printf("Image        = %s\n", filename.c_str());
+   printf("Size         = %zu x %zu\n", width, height);
+   printf("Desync rows  = %zu (max shift %d)\n", N_desynced, generator.max_shift);
+   printf("Generated in   %.3f s\n\n", t_generate);
+
+   start = Clock::now();
+   Image img(filename, false);
+   const double t_load = seconds_since(start);
+
+   /* a single cross-correlation pass, which is what each iteration is made of */
+   start = Clock::now();
+   std::vector<int> peaks(height);
+   for (size_t r = 1; r < height; r++) {
+      const Row xcorr = img.cross_correlate(img.rows[r], img.rows[r-1]);
+      peaks[r] = img.peak(xcorr);
+   }
+   const double t_correlate = seconds_since(start);
+
+   start = Clock::now();
+   size_t iterations = 0;
+   size_t rows_processed = 0;
+   while (iterations < iteration_limit) {
+      iterations++;
+      rows_processed += height - 1;
+      printf("Iteration %2zu/%zu: ", iterations, iteration_limit);
+      if ( img.synchronise() == false )
+         break;
+   }
+   const double t_sync = seconds_since(start);
+
+   start = Clock::now();
+   img.save();
+   const double t_save = seconds_since(start);
+
+   /* the syncer only aligns rows relative to each other, so measure each row's
+      leftover shift relative to the most common leftover shift */
+   std::vector<int> residual(height);
+   for (size_t r = 0; r < height; r++) {
+      residual[r] = generator.shifts[r] + img.rows[r].displacement();
+   }
+   std::vector<int> sorted = residual;
+   std::nth_element(sorted.begin(), sorted.begin() + height/2, sorted.end());
+   const int median = sorted[height/2];
+   size_t exact = 0, within_1 = 0, fixed = 0;
+   double total_error = 0.0;
+   for (size_t r = 0; r < height; r++) {
+      const int error = abs(residual[r] - median);
+      if (error == 0) exact++;
+      if (error <= 1) within_1++;
+      if (generator.shifts[r] != 0 && error <= 1) fixed++;
+      total_error += error;
+   }
+
+   /* whole-frame registration, each frame the background moved by a known 
+      shift of up to a twentieth of each dimension */
+   const size_t N_frames = 16;
+   std::mt19937 shift_rng(seed);
+   const int max_dy = (height/20 > 1) ? height/20 : 1;
+   std::uniform_int_distribution<int> shift_x(-generator.max_shift, generator.max_shift);
+   std::uniform_int_distribution<int> shift_y(-max_dy, max_dy);
+   Registration registration(width, height);
+   registration.set_reference(generator.frame(0, 0, 0).data());
+   double t_register = 0.0;
+   size_t registered = 0;
+   double worst_error = 0.0, lowest_confidence = 1.0;
+   for (size_t f = 1; f <= N_frames; f++) {
+      const int dx = shift_x(shift_rng);
+      const int dy = shift_y(shift_rng);
+      const std::vector<double> frame = generator.frame(dx, dy, seed + f);
+      start = Clock::now();
+      const FrameShift found = registration.register_frame(frame.data());
+      t_register += seconds_since(start);
+      const double error = MAX( fabs(found.dx - dx), fabs(found.dy - dy) );
+      if (error < 0.5) registered++;
+      worst_error       = MAX( worst_error, error );
+      lowest_confidence = MIN( lowest_confidence, found.confidence );
+   }
+
+   const double t_total = t_load + t_sync + t_save;
+   printf("\nTimings:\n");
+   printf("\tload       = %8.3f s\n", t_load);
+   printf("\tcorrelate  = %8.3f s  (%.0f rows/s)\n", t_correlate, (height-1)/t_correlate);
+   printf("\tsync       = %8.3f s  (%zu iterations, %.0f rows/s)\n", t_sync, iterations, 
+                                                                    rows_processed/t_sync);
+   printf("\tsave       = %8.3f s\n", t_save);
+   printf("\tregister   = %8.3f s  (%zu frames, %.1f frames/s)\n", t_register, N_frames, 
+                                                              N_frames/t_register);
+   printf("\tend to end = %8.3f s  (%.0f image rows/s)\n", t_total, height/t_total);
+   printf("Accuracy:\n");
+   printf("\trows exactly aligned = %zu/%zu (%.2f%%)\n", exact, height, 100.0*exact/height);
+   printf("\trows within 1 pixel  = %zu/%zu (%.2f%%)\n", within_1, height, 100.0*within_1/height);
+   printf("\tdesynced rows fixed  = %zu/%zu\n", fixed, N_desynced);
+   printf("\tmean error           = %.3f pixels\n", total_error/height);
+   printf("\tframes registered    = %zu/%zu (worst error %.2f pixels, lowest confidence %.2f)\n", 
+          registered, N_frames, worst_error, lowest_confidence);
+   return 0;
+}
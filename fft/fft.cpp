@@ -1,5 +1,8 @@
+#include <sys/stat.h>
+
 #include "../global.h"
 #include "Image.h"
+#include "Batch.h"
 
 /*
    
@@ -14,9 +17,42 @@
                      out all of it's debug output (in case you want to follow 
                      the flow of logic). Default = 0 = no debug output
 
+   Or in batch mode, for any number of images at once:
+      ./syncer [-o output_dir] [-j workers] [-n iteration_limit] <inputs...>
+
+   inputs          = pgm files, directories containing pgm files, or quoted 
+                     globs like "scans/scan_??.pgm". Earlier *_synced.pgm 
+                     outputs are skipped unless named
+   output_dir      = where to write the *_synced.pgm files. Default = next to 
+                     each input. Two inputs with the same name can't share one
+   workers         = number of images processed at once. Default = number of 
+                     cores
+   iteration_limit = as above. Default = 20
+
 */
 
+/* the old single image mode takes a bare image number first. Anything else,
+   or a number that's also the name of a file or directory, is a batch */
+bool is_batch(int argc, char** argv) {
+   if (argc < 2) return false;
+   const std::string first = argv[1];
+   if (first.find_first_not_of("0123456789") != std::string::npos) return true;
+   struct stat info;
+   return stat(first.c_str(), &info) == 0;
+}
+
 int main(int argc, char** argv) {
+   if (is_batch(argc, argv)) {
+      std::vector<std::string> files;
+      std::string output_dir;
+      size_t iteration_limit, workers;
+      get_batch_arguments(argc, argv, &files, &output_dir, &iteration_limit, &workers);
+
+      Batch batch(files, output_dir, iteration_limit, workers);
+      batch.run();
+      return 0;
+   }
+
    /* grab the inputfile number, the iteration limit, and output debug switch
       from command line arguments */
    std::string filename;
@@ -3,6 +3,13 @@
 #include <iostream>
 #include <fstream>
 #include <limits>
+#include <set>
+#include <map>
+#include <thread>
+#include <stdlib.h>
+#include <glob.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #include "global.h"
 
@@ -97,6 +104,9 @@ void get_arguments(int argc,
       printf("e.g. running \"%s 2 10 1\" ", argv[0]);
       printf("will read desync2.pgm, run the synchronisation for 10 "); 
       printf("iterations and print debug output\n\n");
+      printf("Batch mode:\n");
+      printf("\t%s [-o output_dir] [-j workers] [-n iteration_limit] <inputs...>\n", argv[0]);
+      printf("\tinputs can be pgm files, directories of pgm files or quoted globs\n\n");
       printf(RESET);
    }
 
@@ -129,4 +139,131 @@ void get_arguments(int argc,
       ASSERT( third_argument == 0 || third_argument == 1 );
       *print_debug = (bool)third_argument;
    }
+}
+
+static bool ends_with(const std::string& s, const std::string& end) {
+   return s.size() >= end.size() && s.compare(s.size()-end.size(), end.size(), end) == 0;
+}
+
+/* images/desync1.pgm -> desync1, the part of the name an output is made from */
+static std::string base_name(const std::string& path) {
+   const size_t pos_filename  = path.find_last_of("/");
+   const std::string filename = path.substr(pos_filename+1);
+   return filename.substr(0, filename.find_last_of("."));
+}
+
+/* turns one command line input into a list of pgm files. Directories give 
+   every .pgm inside them (not recursively), anything with wildcards in it is 
+   globbed, and anything else is taken as a filename. Results are sorted so 
+   that a batch always runs in the same order. The *_synced.pgm outputs of an
+   earlier run are left out of directories and globs, but not if named */
+std::vector<std::string> expand_input_path(const std::string& path) {
+   std::vector<std::string> output;
+   struct stat info;
+   if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+      DIR* dir = opendir(path.c_str());
+      ASSERT( dir != nullptr );
+      while (struct dirent* entry = readdir(dir)) {
+         const std::string name = entry->d_name;
+         if (name.size() > 4 && ends_with(name, ".pgm") && !ends_with(name, "_synced.pgm")) 
+            output.push_back(path + "/" + name);
+      }
+      closedir(dir);
+   } else if (path.find_first_of("*?[") != std::string::npos) {
+      glob_t matches;
+      if (glob(path.c_str(), 0, nullptr, &matches) == 0) {
+         for (size_t i = 0; i < matches.gl_pathc; i++) {
+            if (!ends_with(matches.gl_pathv[i], "_synced.pgm")) 
+               output.push_back(matches.gl_pathv[i]);
+         }
+      }
+      globfree(&matches);
+   } else {
+      output.push_back(path);
+   }
+   std::sort(output.begin(), output.end());
+   return output;
+}
+
+/* flags can come in any order before or between the inputs:
+      -o = directory to write the synced images into, created if it doesn't 
+           exist (default = next to each input image)
+      -j = number of images to work on at once (default = number of cores)
+      -n = synchronisation iteration limit per image (default = 20)
+   every input has to resolve to at least one readable .pgm file */
+void get_batch_arguments(int argc, 
+                         char** argv, 
+              /*output*/ std::vector<std::string>* files,
+              /*output*/ std::string* output_dir,
+              /*output*/ size_t* run_limit,
+              /*output*/ size_t* workers) {
+   files->clear();
+   output_dir->clear();
+   *run_limit = 20;
+   *workers   = std::thread::hardware_concurrency();
+   if (*workers == 0) *workers = 1;
+
+   for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      if (arg == "-o" || arg == "-j" || arg == "-n") {
+         ASSERT( i+1 < argc );
+         const std::string value = argv[++i];
+         if (arg == "-o") {
+            *output_dir = value;
+         } else {
+            ASSERT( isdigit(value[0]) );
+            const int number = atoi(value.c_str());
+            ASSERT( number >= 1 );
+            if (arg == "-j") *workers   = number;
+            else             *run_limit = number;
+         }
+      } else {
+         const std::vector<std::string> expanded = expand_input_path(arg);
+         if (expanded.empty()) 
+            printf(YELLOW "Nothing matched %s\n" RESET, arg.c_str());
+         files->insert(files->end(), expanded.begin(), expanded.end());
+      }
+   }
+   ASSERT( files->size() > 0 );
+
+   /* the same image listed twice would have two workers writing one output,
+      so they're compared by real path (a/x.pgm is ./a/x.pgm) */
+   std::set<std::string> seen;
+   std::vector<std::string> unique;
+   for (const auto& f : *files) {
+      char* real = realpath(f.c_str(), nullptr);
+      const std::string key = (real != nullptr) ? std::string(real) : f;
+      free(real);
+      if (seen.insert(key).second) unique.push_back(f);
+   }
+   files->swap(unique);
+
+   /* check everything up front, so a typo doesn't kill the batch halfway */
+   for (const auto& f : *files) {
+      const size_t pos = f.find_last_of(".");
+      ASSERT( pos != std::string::npos && f.substr(pos+1) == "pgm" );
+      std::ifstream image_file(f);
+      if (!image_file.is_open()) printf(RED "Can't open %s\n" RESET, f.c_str());
+      ASSERT( image_file.is_open() );
+   }
+
+   /* with everything going into one directory, a/x.pgm and b/x.pgm would both
+      be saved as x_synced.pgm */
+   if (!output_dir->empty()) {
+      std::map<std::string, std::string> outputs; /* base name -> input */
+      bool clash = false;
+      for (const auto& f : *files) {
+         const auto inserted = outputs.insert(std::make_pair(base_name(f), f));
+         if (!inserted.second) {
+            printf(RED "%s and %s would both be saved as %s/%s_synced.pgm\n" RESET, 
+                   inserted.first->second.c_str(), f.c_str(), output_dir->c_str(), base_name(f).c_str());
+            clash = true;
+         }
+      }
+      ASSERT( !clash );
+
+      mkdir(output_dir->c_str(), 0755);
+      struct stat info;
+      ASSERT( stat(output_dir->c_str(), &info) == 0 && S_ISDIR(info.st_mode) );
+   }
 }
\ No newline at end of file
@@ -44,14 +44,17 @@ template<class T> size_t index_of(const T& elem, const std::vector<T>& arr) {
 void fftw_complex_to_vectors(const fftw_complex* c, const size_t N, std::vector<double>* re, std::vector<double>* im);
 // bool is_in_array(const size_t x, const std::vector<size_t>& arr);
 #define PRINT(var) std::cout<<#var<<" = "<<var<<std::endl;
-#define ROUND(x) (x>0)?(int)(x+0.5):(int)(x-0.5)
+#define ROUND(x) (((x)>0)?(int)((x)+0.5):(int)((x)-0.5))
 void get_arguments(int argc, char** argv, std::string* filename, size_t* run_limit, bool* print_debug);
+void get_batch_arguments(int argc, char** argv, std::vector<std::string>* files, std::string* output_dir, 
+                         size_t* run_limit, size_t* workers);
+std::vector<std::string> expand_input_path(const std::string& path);
 
 /* 
    CP3 
 */
-#define MIN(x,y) (x<y)?x:y
-#define MAX(x,y) (x>y)?x:y
+#define MIN(x,y) (((x)<(y))?(x):(y))
+#define MAX(x,y) (((x)>(y))?(x):(y))
 // macros to conveniently grab strings from things
 #define set_function_to_minimise(func) set_function_to_minimise_implementation(func,#func)
 #define set_model_function(func)       set_model_function_implementation(func,#func)
@@ -63,6 +66,9 @@ typedef std::vector<double> EArray;
 // To help readability
 typedef double (*ModelFunction)(const double, const Params&); // e.g. linear/quadratic/sin/exp
 typedef double (*FunctionToMinimise)(const class DataPoints&, const Params&, ModelFunction model_function); // e.g. chisq
+typedef void (*ModelGradient)(const double, const Params&, Params* gradient); // dy/dp for each parameter at x
+typedef void (*BatchFunctionToMinimise)(const class DataPoints&, const double* params, const size_t N_sets, 
+                                        double* output); // e.g. chisq for many parameter sets in one pass
 // defined in global.cpp
 XArray generate_smooth_x_values(const XArray& xinput,const size_t N_points);
 